@@ -3,8 +3,10 @@
 
 		converts dBaseIII style .dbf/.dbt files into an ASCII
 		file format used by the Dfile program and library of routines.
+		dBase IV .dbt and FoxPro .fpt memo files are read as well.
 
-		usage: dbf2dff [-ghpPut -s # -o file -m name] file
+		usage: dbf2dff [-bghilMpPrutxz -s # -k key -o file -m name -f fields
+			-w test -a # -j # -c # -D fd -A fd] file ...
 
 		the dBase file is converted into Dfile files with suffix:
 			.dff	-	equivalent to the .dbf+.dbt files.
@@ -16,6 +18,10 @@
 					if the -g flag is used.
 			.hlp	-	user-editable help template file,
 					if the -h flag is used.
+			.dfc	-	checkpoint of the records converted,
+					if the -i or -c flag is used.
+			.dfx	-	binary copy of the .dfa,
+					if the -x flag is used.
 		flags:
 		-g	will generate the Dfile-usable header
 			description file (with extension .dfh),
@@ -27,9 +33,9 @@
 			by the Dfile program.
 		-P	marks converted files as "protected" from change
 			by the Dfile program.
-		-u	ignore deleted records in the dBase file.
-			the default is to convert deleted records into
-			undeleted Dfile records.
+		-u	undelete: convert deleted records in the
+			dBase file into undeleted Dfile records.
+			the default is to leave deleted records out.
 		-s	the dBase file is split into .dff databases whose
 			names will be the 1st character in the `#'-th field.
 			the dBase file will be converted into (up to) 28 Dfile
@@ -38,6 +44,26 @@
 			if this flag is not used, the dBase file(s) will
 			be converted into a single Dfile database with the
 			same name as the dBase file.
+		-k	split on the -s field by `key' instead:
+			pN	the 1st N chars of the field; one
+				database per distinct prefix.
+			hN	a hash of the field, into N databases
+				named 0..N-1.
+			bN	numeric fields: buckets N wide, named
+				by their low end (`m' for minus).
+				date fields: buckets of N months,
+				named YYYYMM by their first month.
+			rN	N ranges holding about as many records
+				each, named 0..N-1.  the ranges come
+				from a sample of the field taken
+				before converting, and are listed in
+				the `model'.dfr file.
+			fields of any type but memo can be split by pN,
+			hN or rN.  blank fields go to the "other"
+			database, or sort first in rN ranges.
+			at most 64 databases are open at once, fewer
+			if the open file limit (ulimit -n) is low;
+			others are closed until they are needed again.
 		-m	if you convert several dBase files that have identical
 			field descriptions, or use the -s flag,
 			it is nice to assign a "model" name to those sets
@@ -47,6 +73,124 @@
 			`file' is the default.
 		-o	specify an output file.
 			this is ignored if the -s and -m flags are used.
+		-f	convert only the listed fields, in the order
+			listed.  `fields' is a comma-separated list of
+			field names or field numbers (1..n).
+			the .dfh/.dfw/.hlp files describe only these fields.
+		-w	convert only the records that pass `test'.
+			a test compares a field (name or number) with a
+			value: FIELD=value, !=, <, <=, >, >=, ^= (starts
+			with), or FIELD=lo..hi for a range.  tests can be
+			joined with & (and), | (or), ! (not) and brackets.
+			values may be quoted, and then are never a range.
+			numeric fields compare as numbers, and need a
+			number to compare with; others compare as stored
+			in the dBase file.
+			e.g.  -w "REGION=NE & AMOUNT>=100"
+		-a	hold up to `#' Mbytes of .dfa record addresses in
+			memory (64 by default).  past that, addresses
+			are kept in .dft temp files until the end of the
+			conversion.  -a 0 always uses the temp files.
+		-j	convert with `#' threads (-j 0: one per
+			processor).  each thread converts up to
+			4096 records (or a Mbyte of them) at a
+			time; the .dff blocks are numbered in
+			record order before they are written, so
+			the files are the same as those of a
+			single-threaded conversion.
+		-l	pipeline the conversion: one thread reads
+			the dBase files, one converts the records,
+			and one writes the Dfile files, each
+			working on its own batch of records.
+			cannot be used with -j.
+		-b	batch: convert every dBase file named, each
+			into its own Dfile files, `#' of them at a
+			time with -j.  a name may be a directory
+			(its .dbf or .DBF files), a quoted wildcard
+			(the .dbf files it matches), or @file (a
+			list of names, one per line).  the
+			largest files go first; a thread out of
+			files takes one from another.  ends with a
+			report on every file.  cannot be used with
+			-o, -m or -s.
+		-M	merge: convert every dBase file named, in
+			the order given, into one Dfile database,
+			as if their records were in one file.  the
+			files must have the same fields: names,
+			types, lengths and decimals.  a directory
+			gives its .dbf files in name order.  each
+			file reads its own memos, and with -j their
+			records are converted side by side.  the
+			first file names the output, unless -o is
+			used.  cannot be used with -b, -c, -i, -l,
+			-r or -k rN.
+		-i	incremental: convert only the records
+			added to the dBase file since the last -i
+			run, appending them to its Dfile files.
+			each run leaves a `file'.dfc checkpoint;
+			if the dBase file's fields, the flags or
+			the .dff files have changed since, every
+			record is converted again.  records
+			changed or deleted after they were
+			converted are not seen.  cannot be used
+			with -k rN or -M.
+		-c	checkpoint every `#' records: the Dfile
+			files written so far are synced to disk,
+			and `file'.dfc records where they stand.
+			a conversion that fails after one keeps
+			its files, to be picked up by -r.  the
+			.dfa addresses are kept in .dft files
+			until the end, as with -a 0.
+		-r	resume a -c conversion that failed: cut
+			its files back to the last checkpoint and
+			convert the records after it.  the dBase
+			file and flags must be those of the
+			failed run; if they are not, every record
+			is converted again.  the Dfile files are
+			the same as those of a conversion that
+			did not fail.
+			goes on checkpointing, every 1000000
+			records unless -c is used.
+		-D	read the memos from the open descriptor
+			`fd' (e.g.  -D 3 3<file.dbt) instead of
+			by name.  memos read from a pipe are
+			copied to a temp file first.
+		-A	write the .dfa to the open descriptor
+			`fd' (e.g.  -A 4 4>file.dfa) instead of
+			by name.  cannot be used with -s.
+		-	a dBase file named `-' is read from stdin,
+			which may be a pipe: its records are read
+			in order, and -j becomes -l.  its memos
+			need -D.  cannot be used with -k rN, -b
+			or -M.
+		-o -	write the .dff to stdout, as a dBase file
+			named `-' does without -o.  needs -A and
+			-m, and is terse; the .dfa addresses are
+			held in memory until the end.
+			-, -o - and -A cannot be used with -c, -i
+			or -r.
+		-z	gzip the .dff and .dfa files, as
+			`file'.dff.gz and `file'.dfa.gz (or to
+			stdout and -A).  each is compressed by a
+			helper thread as it is written.  a split
+			database closed and opened again gets
+			another gzip member.  cannot be used with
+			-c, -i or -r.
+			gzip'd dBase files are read with or
+			without -z: `file'.dbf.gz, a gzip'd .dbf,
+			.dbt or .fpt, or a gzip'd pipe.  a helper
+			thread uncompresses a .dbf, which is read
+			as a pipe is: records in order.  so -c,
+			-i, -r and -k rN cannot be used with a
+			gzip'd .dbf.  memos are uncompressed to a
+			temp file first.
+			-z and gzip'd files need a build with
+			DF_USE_ZLIB defined (and -lz).
+		-x	also write the .dfa addresses as
+			`file'.dfx, in binary, so that Dfile can
+			map it into memory and find record N
+			without reading the .dfa.  it is never
+			gzip'd.  cannot be used with -o -.
 		-t	terse; do not show conversion progress.
 
 	Dfile format explained
@@ -80,6 +224,14 @@
 			data record found in the companion .dff file.
 			Dfile reads the .dfa file first and uses these block
 			pointers to access .dff data.
+		.dfx files:
+			a 32-byte header, "DFX", a version byte (1), the
+			header length, the number of records N, where the
+			bitmap starts and the .dff block length; then the
+			starting block of each record, 8 bytes each; then
+			a bitmap of the protected records, 1 bit each.
+			numbers are little-endian.  a record starts at
+			byte 79 * its block of the .dff file.
 
 		both the .ddf and .dfa files are ASCII files, which *can* be
 		hand edited, as long as the block integrity is upheld.
@@ -115,35 +267,123 @@
 //#include	<malloc.h>	/* for malloc(), free() */
 #include	<ctype.h>	/* for isascii() */
 #include	<string.h>	/* for strncpy(), etc */
+#include	<stdlib.h>	/* for malloc(), atof(), etc */
 #include	<math.h>	/* for strncpy(), etc */
+#include	<setjmp.h>	/* for -b's setjmp(), longjmp() */
+#include	<time.h>	/* for -b's time() */
+#include	<errno.h>	/* for errno */
+
+#if defined(unix) || defined(__unix) || defined(__unix__) || \
+	(defined(__APPLE__) && defined(__MACH__))
+#	define	DF_HAVE_MMAP		/* map the dBase files into memory */
+#	define	DF_HAVE_PWRITE		/* positioned writes to the outputs */
+#	define	DF_HAVE_THREADS		/* -j converts with pthreads */
+#	define	DF_HAVE_GLOB		/* -b expands directories and globs */
+#	define	DF_HAVE_RLIMIT		/* open split files to the fd limit */
+#endif
+
+#if defined(DF_USE_IO_URING) && defined(__linux__)
+#	define	DF_HAVE_IO_URING	/* queue output writes with io_uring */
+#endif
+
+#if defined(DF_USE_ZLIB) && defined(DF_HAVE_THREADS)
+#	define	DF_HAVE_ZLIB		/* gzip'd inputs and -z outputs */
+#endif
+
+#if defined(__linux__)
+#	define	DF_HAVE_COPY_RANGE	/* copy the .dft in the kernel */
+#endif
+
+#if defined(__AVX2__)
+#	define	DF_HAVE_AVX2		/* trim text 32 bytes at a time */
+#elif defined(__SSE2__)
+#	define	DF_HAVE_SSE2		/* trim text 16 bytes at a time */
+#endif
+
+#include	<fcntl.h>	/* for open() */
+#ifdef	DF_HAVE_MMAP
+#	include	<sys/types.h>
+#	include	<sys/stat.h>
+#	include	<sys/mman.h>	/* for mmap(), madvise() */
+#	include	<unistd.h>
+#else
+#	include	<io.h>		/* for write(), lseek(), close() */
+#endif
+#ifdef	DF_HAVE_AVX2
+#	include	<immintrin.h>	/* for _mm256_*() */
+#endif
+#ifdef	DF_HAVE_SSE2
+#	include	<emmintrin.h>	/* for _mm_*() */
+#endif
+#ifdef	DF_HAVE_IO_URING
+#	include	<sys/syscall.h>
+#	include	<sys/uio.h>
+#	include	<linux/io_uring.h>
+#endif
+#ifdef	DF_HAVE_COPY_RANGE
+#	include	<sys/syscall.h>	/* for SYS_copy_file_range */
+#endif
+#ifdef	DF_HAVE_THREADS
+#	include	<pthread.h>	/* for pthread_create(), pthread_join() */
+#	include	<sched.h>	/* for sched_yield() */
+#endif
+#ifdef	DF_HAVE_RLIMIT
+#	include	<sys/resource.h>	/* for getrlimit() */
+#endif
+#ifdef	DF_HAVE_GLOB
+#	include	<dirent.h>	/* for opendir(), readdir() */
+#	include	<glob.h>	/* for glob() */
+#endif
+#ifdef	DF_HAVE_ZLIB
+#	include	<zlib.h>	/* for gzdopen(), gzread(), gzwrite() */
+#	include	<signal.h>	/* for signal() */
+#endif
 
 /*
 	fixed DBASE constants
  */
 #define	DBASE_MEMO_BLOCK	512	/* MEMO fld block size */
 #define	DBASE_MEMO_END		26	/* memo records end with two of these */
-#define	DBASE_MAX_MEMO_BLOCKS	4	/* MEMOs can have this many blocks */
+#define	DBASE_MAX_MEMO_BLOCKS	4	/* MEMOs usually fit in this many */
 #define	DBASE_HEADER_SIZE	32
 #define	DBASE_LINE_FEED		10
 #define	DBASE_CARRIAGE		13
 #define	DBASE_COOKIE		0x3
 #define	DBASE_MEMO_COOKIE	0x83
+#define	DBASE4_MEMO_COOKIE	0x8b	/* dBase IV, length-prefixed .dbt */
+#define	DBASE4_SQL_MEMO_COOKIE	0xcb
+#define	FOXBASE_MEMO_COOKIE	0xfb	/* FoxBASE+, dBaseIII style .dbt */
+#define	FOXPRO_MEMO_COOKIE	0xf5	/* FoxPro 2.x, .fpt memos */
+#define	VFP_COOKIE		0x30	/* Visual FoxPro */
+#define	VFP_AUTOINC_COOKIE	0x31
+#define	VFP_VARCHAR_COOKIE	0x32
+#define	VFP_FLAGS_OFFSET	28	/* .dbf header table flags byte */
+#define	VFP_HAS_MEMO		0x2	/* table flag: .fpt in use */
+#define	DBASE_FIELD_END		0xd	/* ends the field descriptors */
+#define	DBASE_MEMO_III		0	/* 0x1a-terminated memos */
+#define	DBASE_MEMO_IV		1	/* dBase IV length-prefixed memos */
+#define	DBASE_MEMO_FOX		2	/* FoxPro length-prefixed memos */
+#define	DBASE_MEMO_HEADER	8	/* dBase IV/FoxPro memo block header */
+#define	DBASE4_MEMO_SIG		"\377\377\010\000"
+#define	DBASE4_BLOCK_OFFSET	20	/* .dbt header block length (LE) */
+#define	FOXPRO_BLOCK_OFFSET	6	/* .fpt header block length (BE) */
 #define	DBASE_DELETED		'*'
 #define	DBASE_DBF_EXT		"dbf"
 #define	DBASE_DBT_EXT		"dbt"
+#define	DBASE_FPT_EXT		"fpt"
 #define	DBASE_CHARACTER_FLD	'C'	/* maps to Dfile ALP type */
 #define	DBASE_LOGICAL_FLD	'L'	/* maps to Dfile ALP type */
 #define	DBASE_DATE_FLD		'D'	/* maps to Dfile ALP type */
 #define	DBASE_NUMERIC_FLD	'N'	/* maps to Dfile INT and FLT types */
 #define	DBASE_MEMO_FLD		'M'	/* maps to Dfile MEMO type */
+#define	DBASE_FLOAT_FLD		'F'	/* FoxPro; same as NUMERIC */
 #define	DBASE_FLD_NAME_LEN	11	/* chars in field name */
+#define	DBASE_DATE_LEN		8	/* YYYYMMDD */
 
-char	tmp_byte[4];
+char	trim_xlat[256];		/* byte in trimmed text, or 0 at the end */
 #define	GetByte(f)	getc(f)
-#define	GetInt(f)	(int)(fread((char *)tmp_byte, 1, 2, f), \
-			dff_BytesToLong((char *)tmp_byte, 2))
-#define	GetLong(f)	(long)(fread((char *)tmp_byte, 1, 4, f), \
-			dff_BytesToLong((char *)tmp_byte, 4))
+#define	GetInt(f)	(int)dff_GetBytes(f, 2)
+#define	GetLong(f)	dff_GetBytes(f, 4)
 
 /*
 	fixed Dfile constants
@@ -160,13 +400,37 @@ char	tmp_byte[4];
 #define	DF_OTHER_NAME		"other"
 #define	DF_NUMBER_NAME		"numbers"
 #define	DF_NOT_SPLIT		-1	/* dBase file not being split */
+#define	DF_KEY_LETTER		0	/* -s split on the 1st letter */
+#define	DF_KEY_PREFIX		'p'	/* -k pN: split on N chars */
+#define	DF_KEY_HASH		'h'	/* -k hN: split on a hash mod N */
+#define	DF_KEY_BUCKET		'b'	/* -k bN: split on value buckets */
+#define	DF_KEY_RANGE		'r'	/* -k rN: split on sampled ranges */
+#define	DF_SAMPLE_RECS		65536	/* most records sampled for -k rN */
+#define	DF_KEY_LEN		32	/* longest -k pN prefix */
+#define	DF_MAX_OPEN		64	/* split databases open at once */
+#define	DF_FD_RESERVE		16	/* fds kept for the inputs, .dfa, etc */
 #define	DF_TMP_EXT		"dft"	/* the database file extension */
 #define	DF_DF_EXT		"dff"	/* the database file extension */
 #define	DF_ADR_EXT		"dfa"	/* the address file extension */
+#define	DF_IDX_EXT		"dfx"	/* the -x binary address extension */
 #define	DF_HDR_EXT		"dfh"	/* the -g header file extension */
+#define	DF_RNG_EXT		"dfr"	/* the -k rN range manifest extension */
 #define	DF_WIN_EXT		"dfw"	/* the -g window file extension */
 #define	DF_HLP_EXT		"hlp"	/* the -h help file extension */
+#define	DF_CKP_EXT		"dfc"	/* the -i/-c checkpoint extension */
+#define	DF_CKP_NEW_EXT		"dfn"	/* a checkpoint being written */
+#define	DF_CKP_RECS		1000000	/* -r records between checkpoints */
+#define	DF_STDIO		"-"	/* .dbf from stdin, .dff to stdout */
+#define	DF_GZ_SUFFIX		".gz"	/* ends a gzip'd file name */
+#define	DF_GZ_MAGIC_1		0x1f	/* a gzip'd file starts with these */
+#define	DF_GZ_MAGIC_2		0x8b
+#define	DF_ZIP_MODE		"wb6"	/* -z gzip level */
+#define	DF_IDX_MAGIC		"DFX"	/* starts a .dfx file */
+#define	DF_IDX_VERSION		1	/* .dfx layout, after the magic */
+#define	DF_IDX_HEAD		32	/* .dfx header bytes */
+#define	DF_IDX_ADDR		8	/* bytes per .dfx block address */
 #define	DF_MAX_MEMO_SIZE	((DBASE_MAX_MEMO_BLOCKS * DBASE_MEMO_BLOCK) + 1)
+#define	DF_MEMO_CHUNK		(DF_MAX_MEMO_SIZE - 1)	/* memo bytes per pass */
 #define	DF_DELIM		'\\'
 #define	DF_DELIMS		"\\"
 #define	DF_REPORT_DEFAULT	100
@@ -182,6 +446,50 @@ char	tmp_byte[4];
 #define	DF_SEARCH_INCLUSIVE	"incl"
 #define	DF_WRITING_RECORD	0	/* flags for dff_WriteBlocks() */
 #define	DF_WRITING_MEMO		1
+#define	DF_MAP_WINDOW		(1024L * 1024L)	/* madvise() read-ahead */
+#define	DF_OUT_BUFSIZE		(64 * 1024)	/* .dff/.dft output buffer */
+#define	DF_ZIP_BUFSIZE		(64 * 1024)	/* bytes a gzip helper moves */
+#define	DF_ADDR_LIMIT		64	/* Mbytes of .dfa addresses held */
+#define	DF_ADDR_CHUNK		4096	/* first .dfa address allocation */
+#define	DF_ADDR_ALL		0x7fffffffL	/* -o -: hold every address */
+#define	DF_IO_DEPTH		32	/* io_uring writes in flight */
+#define	DF_CACHE_BLOCKS		2048	/* .dbt blocks held in the cache */
+#define	DF_CACHE_HASH		4096	/* cache hash buckets (power of 2) */
+#define	DF_PREFETCH_RECS	64	/* records scanned ahead for memos */
+#define	DF_PREFETCH_GAP		8	/* unused .dbt blocks worth reading */
+#define	DF_PREFETCH_MAX		512	/* .dbt blocks per prefetch read */
+#define	DF_JOB_RECS		4096	/* dBase records per -j job */
+#define	DF_JOB_BYTES		(1024L * 1024L)	/* .dbf bytes per job */
+#define	DF_PIPE_JOBS		4	/* jobs passed round the -l stages */
+#define	DF_RING_SIZE		4	/* jobs a -l ring holds (power of 2) */
+#define	DF_MAX_JOBS		256	/* most -j jobs */
+#define	DF_BATCH_CHUNK		64	/* first -b file allocation */
+#define	DF_NAME_LEN		1024	/* file name with its extension */
+#define	DF_JOB_CONVERT		0	/* job phases for dBase_JobThread() */
+#define	DF_JOB_FORMAT		1
+#define	DF_JOB_OK		0	/* job failures */
+#define	DF_JOB_SHORT		1
+#define	DF_JOB_NOSPACE		2	/* out of memory or disk space */
+#define	DF_BLOCKS(len)		((len) == 0 ? 1L : \
+				((long)(len) + DF_REC_WIDTH - 1) / DF_REC_WIDTH)
+#define	DF_STEP_TEXT		0	/* plan steps for dBase_ProcessRecord() */
+#define	DF_STEP_NUMBER		1
+#define	DF_STEP_LOGICAL		2
+#define	DF_STEP_DATE		3
+#define	DF_STEP_MEMO		4
+#define	DF_PLAIN(c)		((c) > ' ' && (c) < 0x7f && (c) != DF_DELIM)
+#define	DF_FLD_SLACK		32	/* room for a field to grow by */
+#define	DF_TEST_EQ		0	/* -w tests for dBase_Filter() */
+#define	DF_TEST_NE		1
+#define	DF_TEST_LT		2
+#define	DF_TEST_LE		3
+#define	DF_TEST_GT		4
+#define	DF_TEST_GE		5
+#define	DF_TEST_PREFIX		6
+#define	DF_TEST_RANGE		7
+#define	DF_TEST_AND		8	/* tests at or past here join tests */
+#define	DF_TEST_OR		9
+#define	DF_TEST_NOT		10
 
 #define	THIS_DIR		"."
 #define	DF_SUCCESS			0	/* good exit */
@@ -190,6 +498,189 @@ char	tmp_byte[4];
 #define	FLAG_SET(f)		((f) == (unsigned)1)
 #define	FLAG_NOT_SET(f)		((f) == (unsigned)0)
 
+#ifdef	DF_HAVE_ZLIB
+/*
+	a gzip helper thread, at the other end of a pipe: it
+	compresses what is written to the pipe, or fills the pipe
+	with what it uncompresses.
+ */
+typedef struct	{
+	gzFile		gz;		/* the gzip'd file */
+	int		other,		/* the helper's end of the pipe */
+			writing,	/* compressing (else reading) */
+			failed;		/* the helper hit an error */
+	pthread_t	thread;
+}	DF_ZIP;
+#endif
+
+/*
+	buffered output file; written with pwrite() or queued on
+	the io_uring.
+ */
+typedef struct	{
+	int	fd,			/* output file (or -1 when closed) */
+		used,			/* bytes waiting in `buffer' */
+		seq;			/* a pipe: written in order */
+	long	offset;			/* file offset `buffer' goes to */
+	char	*buffer;		/* DF_OUT_BUFSIZE bytes */
+#ifdef	DF_HAVE_ZLIB
+	DF_ZIP	*zip;			/* -z helper (or NULL) */
+#endif
+}	DF_OUT;
+
+/*
+	the .dfa record addresses of one output file.  they are
+	held in memory until too many are held, then kept in the
+	.dft temp file instead.
+ */
+typedef struct	{
+	char	*text;			/* .dft lines (or NULL) */
+	long	used,			/* bytes in `text' */
+		size;			/* bytes allocated for `text' */
+	int	spilled;		/* lines go to the .dft file */
+}	DF_ADDRS;
+
+/*
+	the -x .dfx file being built from .dfa address lines.
+ */
+typedef struct	{
+	FILE	*fp;			/* the .dfx file */
+	unsigned char	*bits;		/* protected record bitmap */
+	long	rec,			/* records written */
+		block;			/* block of the line being read */
+	int	col;			/* 0: logical, 1: physical */
+}	DF_INDEX;
+
+/*
+	a split field value; numeric fields are ordered by `num',
+	others by `text'.
+ */
+typedef struct	{
+	double	num;			/* value of a numeric field */
+	char	*text;			/* trimmed field text */
+}	DF_BOUND;
+
+/*
+	one output Dfile database.  during a split conversion up to
+	`max_open' of them stay open, so a record is written where
+	it belongs as soon as it is decoded.  the least recently used
+	is closed to make room for another.
+ */
+typedef struct	{
+	char		*name;		/* file name, less extension */
+	DF_OUT		dff,		/* .dff output */
+			dfa;		/* .dft output */
+	DF_ADDRS	addrs;		/* .dfa addresses */
+	int		newer,		/* open parts, in order of use */
+			older;
+	long		logical,	/* the last .dff rec written */
+			physical,	/* the last .dff block written */
+			kept,		/* .dff bytes from the last -i run */
+			next_value;	/* value in `next_addr' (or -1) */
+	char		next_addr[DF_ADDR_WIDTH]; /* `next_value' as text */
+}	DF_PART;
+
+#ifdef	DF_HAVE_IO_URING
+/*
+	an io_uring with DF_IO_DEPTH write slots.  a slot owns a
+	buffer; a free slot's buffer is swapped for the buffer of
+	the DF_OUT being flushed, so nothing is copied.
+ */
+typedef struct	{
+	int		fd;			/* the ring */
+	unsigned	*sq_head, *sq_tail, *sq_mask, *sq_array,
+			*cq_head, *cq_tail, *cq_mask;
+	struct io_uring_sqe	*sqes;
+	struct io_uring_cqe	*cqes;
+	void		*sq_map, *cq_map;
+	size_t		sq_map_len, cq_map_len, sqes_len;
+	int		in_flight;
+	struct {
+		int		busy,		/* write queued */
+				fd;
+		long		offset;
+		struct iovec	iov;
+		char		*buffer;
+	}	slot[DF_IO_DEPTH];
+}	DF_IO;
+#endif
+
+/*
+	state of a memo being trimmed by dff_TrimChunk().
+ */
+typedef struct	{
+	int	exact,			/* length known; no end marker */
+		cur,			/* byte waiting for the next (or -1) */
+		run,			/* last of a run of blanks (or 0) */
+		lead,			/* still dropping leading spaces */
+		blank,			/* last byte trimmed was a blank */
+		done;			/* end of the memo text seen */
+}	DF_TRIM;
+
+/*
+	LRU cache of DBASE_MEMO_BLOCK sized .dbt blocks, used when
+	the .dbt cannot be mapped.  slots are kept on a list with
+	the most recently used first, and hashed on block number.
+ */
+typedef struct	{
+	long	*block;			/* .dbt block in slot (or -1) */
+	int	*valid,			/* bytes of the block read */
+		*next, *prev,		/* LRU list */
+		*chain,			/* hash chain */
+		hash[DF_CACHE_HASH],	/* first slot per bucket */
+		head, tail;		/* most, least recently used */
+	char	*data,			/* DF_CACHE_BLOCKS blocks */
+		*stage;			/* DF_PREFETCH_MAX blocks */
+}	DF_CACHE;
+
+/*
+	the parts of a decimal number, as found by dBase_NumberParts().
+ */
+typedef struct	{
+	int	neg,			/* negative */
+		whole_len,		/* digits in `whole' */
+		frac_len;		/* digits in `frac' */
+	char	*whole,			/* whole part, less leading zeros */
+		*frac;			/* fraction, less trailing zeros */
+}	DF_NUM;
+
+/*
+	one test of the -w filter, compiled by dBase_CompileFilter().
+ */
+typedef struct	{
+	int	op,			/* DF_TEST_EQ, ... DF_TEST_NOT */
+		fld,			/* dBase field # */
+		off,			/* field offset in the record */
+		len,			/* field width */
+		num,			/* compare as numbers */
+		left, right,		/* tests joined by AND, OR, NOT */
+		lo_len, hi_len;
+	char	*lo, *hi;		/* values; the same unless a range */
+	DF_NUM	lo_num, hi_num;		/* numeric values */
+}	DF_TEST;
+
+/*
+	one step of the record conversion plan; the plan has a
+	step per field, compiled from the field descriptors.
+ */
+typedef struct	{
+	int	op,			/* DF_STEP_TEXT, _NUMBER, ... */
+		fld,			/* dBase field # */
+		off,			/* field offset in the record */
+		len;			/* field width */
+}	DF_STEP;
+
+/*
+	a dBase file converted by -b, or merged by -M.
+ */
+typedef struct	{
+	char	*name;			/* basename of .dbf/.dbt file(s) */
+	long	size,			/* bytes in the .dbf and memo file */
+		records,		/* # of dBase records */
+		converted;		/* # of Dfile records written */
+	int	status;			/* DF_SUCCESS or DF_FAILURE */
+}	DF_BATCH;
+
 /*
 	Dfile info used in converstion.
  */
@@ -198,39 +689,212 @@ typedef struct	{
 		*out_file,		/* basename of .dff/.dfa/.dfh/.dfw */
 		*out_dir,		/* named output directory */
 		*model,			/* Dfile model .dff files used with */
+		*fields,		/* -f list of fields to convert */
+		*where,			/* -w filter expression */
+		*fld_name,		/* dBase field names */
 		*fld_buffer,		/* for decoding flds */
 		*rec_buffer,		/* for holding input dBase records */
 		*out_buffer,		/* for holding output Dfile records */
-		*memo_buffer;		/* for writing memos */
+		*memo_buffer,		/* for writing memos */
+		block[DF_REC_WIDTH],	/* .dff block being filled */
+		*dbf_map,		/* mapped .dbf file (or NULL) */
+		*dbt_map,		/* mapped .dbt file (or NULL) */
+		*peek_buffer,		/* records read ahead for memos */
+		*dbf_head,		/* header of a piped .dbf (or NULL) */
+		file_name[DF_NAME_LEN],	/* for dff_FileAndExt() */
+		dfile_name[DF_NAME_LEN]; /* for dff_GenDfilename() */
 	int	split,			/* fld to split on (or DF_NOT_SPLIT) */
+		key_how,		/* DF_KEY_LETTER, _PREFIX, ... */
+		key_arg,		/* N of the -k key */
+		num_parts,		/* # of output Dfile databases */
+		max_parts,		/* # allocated in `part' */
+		hash_size,		/* # of `part_hash' slots */
+		*part_hash,		/* `part' #s by name (or -1) */
+		num_open,		/* # of open parts */
+		max_open,		/* parts open at once */
+		num_bounds,		/* # of `bound's */
+		newest,			/* most recently used open part */
+		oldest,			/* least recently used open part */
 		report,			/* tell progress */
 		indx,			/* current .dff/.dfa file in use */
 		num_flds,		/* # of dBase fields */
+		num_proj,		/* # of fields converted */
+		num_tests,		/* # of tests in `filter' */
+		filter_top,		/* the test that decides */
+		*proj,			/* dBase field # of each converted fld */
 		*fld_type,		/* dBase field types */
 		*fld_len,		/* dBase field lengths */
 		*fld_dec,		/* dBase field decimal lengths */
-		bytes;			/* bytes in the dBase record */
+		bytes,			/* bytes in the dBase record */
+		block_used,		/* bytes in `block' */
+		memo_type,		/* DBASE_MEMO_III, _IV or _FOX */
+		memo_block,		/* bytes per memo block */
+		num_memo,		/* # of dBase memo fields */
+		num_jobs,		/* -j threads converting */
+		num_stages,		/* -l threads running */
+		stop,			/* -l threads are to stop */
+		percent_done,		/* progress shown so far */
+		num_batch,		/* # of -b or -M files */
+		max_batch,		/* # allocated in `batch' */
+		memo_fd,		/* -D memo file descriptor (or -1) */
+		dfa_fd,			/* -A .dfa descriptor (or -1) */
+		*memo_off;		/* memo field #s, then their offsets */
 	struct {
 		unsigned	headers : 1,		/* create header file */
 				protect_file : 1,	/* protect Dfile file */
 				protect_recs : 1,	/* protect Dfile recs */
 				help : 1,		/* create help file */
 				undel : 1,		/* undelete records */
+				pipeline : 1,		/* -l stage threads */
+				batch : 1,		/* -b many files */
+				merge : 1,		/* -M files into one */
+				incremental : 1,	/* -i from a checkpoint */
+				resume : 1,		/* -r from a -c checkpoint */
+				dbf_pipe : 1,		/* .dbf read in order */
+				dff_pipe : 1,		/* .dff to stdout (-o -) */
+				zip : 1,		/* -z gzip the outputs */
+				memo_spool : 1,		/* memos in a temp file */
+				index : 1,		/* -x write the .dfx */
 				terse : 1;		/* terse mode */
 	}	flags;
+	unsigned long	fingerprint;	/* dBase_Fingerprint() (-i) */
 	long	num_records,		/* # of dBase records */
 		rec_num,		/* current dBase record */
-		logical[DF_MAX_SPLIT],	/* the last .dff rec read */
-		physical[DF_MAX_SPLIT];	/* the last .dfa rec read */
-	FILE	*dff,			/* .dff file pointer */
-		*dfa,			/* .dfa/.dft file pointer */
-		*dfh,			/* .dfh file pointer */
+		start_rec,		/* first dBase record converted (-i) */
+		ckp_recs,		/* -c records between checkpoints */
+		ckp_at,			/* records done at the next one */
+		saved_rec,		/* records in the last -c checkpoint */
+		data_offset,		/* start of dBase records in .dbf */
+		dbf_map_len,		/* bytes mapped from the .dbf */
+		dbt_map_len,		/* bytes mapped from the .dbt */
+		advised,		/* end of the madvise() window */
+		addr_held,		/* bytes allocated in `addrs' */
+		addr_limit,		/* most bytes `addrs' may hold */
+		prefetched,		/* memos fetched up to this record */
+		converted;		/* Dfile records written */
+	DF_BATCH *batch;		/* -b or -M files to convert */
+	jmp_buf	*bail;			/* dff_CleanUp() returns here (or NULL) */
+	DF_CACHE *cache;		/* .dbt block cache (or NULL) */
+	DF_TEST	*filter;		/* compiled -w filter (or NULL) */
+	DF_STEP	*plan,			/* record conversion plan */
+		key;			/* the split field */
+	DF_BOUND *bound;		/* -k rN range starts, past the 1st */
+	DF_PART	*part,			/* the output Dfile databases */
+		*cur;			/* `part[indx]' */
+#ifdef	DF_HAVE_IO_URING
+	DF_IO	*io;			/* write queue (or NULL for pwrite) */
+#endif
+#ifdef	DF_HAVE_THREADS
+	pthread_t stage[2];		/* -l read and convert threads */
+#endif
+#ifdef	DF_HAVE_ZLIB
+	DF_ZIP	*dbf_zip;		/* gzip'd .dbf helper (or NULL) */
+#endif
+	FILE	*dfh,			/* .dfh file pointer */
 		*dfw,			/* .dfw file pointer */
 		*hlp,			/* .hlp file pointer */
 		*dbf,			/* dBase .dbf file handle */
+		*dbf_in,		/* piped .dbf, past its header */
 		*dbt;			/* dBase .dbt file handle (or -1) */
 }	DF_INFO;
 
+/*
+	a dBase record converted by a -j job.  its memos come first
+	in the output, then the record.
+ */
+typedef struct	{
+	long	rec,			/* dBase record # */
+		text,			/* record text in the job (or -1) */
+		key,			/* split field text in the job */
+		start,			/* first .dff block of the record */
+		at,			/* output offset in the job */
+		bytes;			/* output bytes, memos included */
+	int	len,			/* record text, less memo addresses */
+		key_len,		/* bytes of split field text */
+		part;			/* output database */
+}	DF_JOBREC;
+
+/*
+	a memo of a record converted by a -j job.
+ */
+typedef struct	{
+	long	text,			/* trimmed memo text in the job */
+		len,			/* bytes of text (or -1: no memo) */
+		start;			/* first .dff block (or 0) */
+	int	at;			/* where its address goes */
+}	DF_JOBMEMO;
+
+/*
+	a run of records converted by one -j thread.  the text of
+	its records is converted without knowing where it will go;
+	once the blocks are numbered the text is formatted into
+	.dff blocks.
+ */
+typedef struct	{
+	DF_INFO	*d,			/* the output */
+		*src;			/* the dBase file read */
+#ifdef	DF_HAVE_THREADS
+	pthread_t	thread;
+#endif
+	int	phase,			/* DF_JOB_CONVERT or _FORMAT */
+		failed,			/* DF_JOB_OK, _SHORT or _NOSPACE */
+		nm;			/* memos per record */
+	long	first, last,		/* dBase records first..last-1 */
+		base,			/* records in earlier -M files */
+		recs,			/* most records in the job */
+		num_recs,		/* # of `rec' used */
+		have,			/* # of records read */
+		bad_rec, bad_len,	/* the record that was short */
+		text_used, text_size,	/* bytes in `text' */
+		blocks_used, blocks_size, /* bytes in `blocks' */
+		offset;			/* .dff offset of `blocks' (or -1) */
+	char	*text,			/* converted text */
+		*blocks,		/* formatted .dff blocks */
+		*raw,			/* the dBase records read */
+		*stage,			/* DF_MEMO_CHUNK memo bytes read */
+		*scratch;		/* a record with its memo addresses */
+	DF_JOBREC	*rec;		/* DF_JOB_RECS records */
+	DF_JOBMEMO	*memo;		/* `nm' memos per record */
+}	DF_JOB;
+
+/*
+	a ring of jobs passed from one -l thread to the next.
+ */
+typedef struct	{
+	DF_JOB		*slot[DF_RING_SIZE];
+	unsigned	head,		/* jobs taken out */
+			tail;		/* jobs put in */
+}	DF_RING;
+
+/*
+	the -l stages, and the rings between them.
+ */
+typedef struct	{
+	DF_INFO	*d;
+	DF_JOB	*job;			/* DF_PIPE_JOBS jobs */
+	DF_RING	empty,			/* jobs to read into */
+		read,			/* jobs to convert */
+		done;			/* jobs to write */
+}	DF_PIPE;
+
+/*
+	a -b thread, and the files it has left, largest first.
+ */
+typedef struct	df_worker {
+	DF_INFO		*d;
+	struct df_worker *pool;		/* all the workers */
+#ifdef	DF_HAVE_THREADS
+	pthread_t	thread;
+	pthread_mutex_t	lock;		/* guards `head' and `tail' */
+#endif
+	int		id,
+			num_workers,
+			started,		/* the thread was created */
+			*item,			/* `d->batch' #s */
+			head,			/* next file to convert */
+			tail;			/* past the last file */
+}	DF_WORKER;
+
 /*
 	prototypes
  */
@@ -250,30 +914,154 @@ extern void	Dfile_WriteHelpText P_((DF_INFO *, char *));
 /*
 	dbf2dff-ish routines.
  */
-extern char	*dff_FileAndExt P_((char *, char *));
+extern char	*dff_FileAndExt P_((DF_INFO *, char *, char *));
+extern char	*dff_FindDbase P_((DF_INFO *, char *, char *));
 extern char	*dff_GenDfilename P_((DF_INFO *, char *));
 extern void	dff_CleanUp P_((DF_INFO *, int));
+extern void	dff_FreeInfo P_((DF_INFO *));
 extern void	dff_OutOfSpace P_((DF_INFO *));
 extern long	dff_BytesToLong P_((char *, int));
+extern long	dff_GetBytes P_((FILE *, int));
+extern void	dff_IoInit P_((DF_INFO *));
+extern void	dff_IoWait P_((DF_INFO *, int, int));
+extern long	dff_WriteAt P_((int, char *, long, long));
+extern void	dff_IoWrite P_((DF_INFO *, DF_OUT *, int));
+extern void	dff_IoEnd P_((DF_INFO *));
+#ifdef	DF_HAVE_ZLIB
+extern int	dff_ZipOpen P_((DF_INFO *, DF_ZIP *, int, int));
+extern void	*dff_ZipThread P_((void *));
+extern int	dff_ZipEnd P_((DF_ZIP *));
+extern FILE	*dBase_Inflate P_((DF_INFO *, int));
+#endif
+extern void	dff_OutOpen P_((DF_INFO *, DF_OUT *, char *, int, int));
+extern void	dff_OutWrite P_((DF_INFO *, DF_OUT *, char *, int));
+extern void	dff_OutClose P_((DF_INFO *, DF_OUT *, int));
+extern void	dff_AddrWrite P_((DF_INFO *, char *, int));
+extern int	dff_AddPart P_((DF_INFO *, char *));
+extern int	dff_FindPart P_((DF_INFO *, char *));
+extern void	dff_InitParts P_((DF_INFO *));
+extern void	dff_LinkPart P_((DF_INFO *, int));
+extern void	dff_UnlinkPart P_((DF_INFO *, int));
+extern void	dff_UsePart P_((DF_INFO *, int));
+extern void	dff_ClosePart P_((DF_INFO *, int, int));
+extern void	dff_CopyFile P_((DF_INFO *, FILE *, char *));
+extern void	dff_MaxOpen P_((DF_INFO *));
 extern void	dff_Open P_((DF_INFO *));
-extern void	dff_WriteBlocks P_((DF_INFO *, char *, int));
+extern int	dff_FormatLong P_((char *, long));
+extern int	dff_FormatAddr P_((char *, long));
+extern char	*dff_NextAddr P_((DF_INFO *, long));
+extern void	dff_OutBlock P_((DF_INFO *, char *, int, char *));
+extern void	dff_FullBlock P_((DF_INFO *, char *));
+extern void	dff_PutBlocks P_((DF_INFO *, char *, int));
+extern void	dff_EndBlocks P_((DF_INFO *));
+extern void	dff_WriteAddr P_((DF_INFO *));
+extern void	dff_WriteBlocks P_((DF_INFO *, char *, int, int));
+extern long	dff_BlockBytes P_((long, long));
+extern long	dff_FormatBlocks P_((char *, char *, long, long));
+extern void	dff_Progress P_((DF_INFO *, long));
 extern int	dff_StripString P_((char **, int));
+extern void	dff_TrimInit P_((void));
+extern int	dff_TrimSpan P_((char *, int, char *));
 extern void	dff_TrimText P_((char **));
+extern void	dff_TrimBegin P_((DF_TRIM *, int));
+extern int	dff_TrimChunk P_((DF_TRIM *, char *, int, char *));
+extern int	dff_TrimEnd P_((DF_TRIM *, char *));
+extern void	dff_PutBytes P_((FILE *, long, int));
+extern void	dff_IndexAddrs P_((DF_INDEX *, char *, long));
+extern void	dff_WriteIndex P_((DF_INFO *, char *));
 extern long	dff_DFTtoDFA P_((DF_INFO *, int));
+extern unsigned long	dBase_Fingerprint P_((DF_INFO *));
+extern void	dff_WriteCheckpoint P_((DF_INFO *, long, int));
+extern void	dff_SaveCheckpoint P_((DF_INFO *, long));
+extern void	dff_ReadCheckpoint P_((DF_INFO *));
 extern void	dff_Init P_((DF_INFO *));
+extern void	dff_Convert P_((DF_INFO *));
+extern void	dff_Merge P_((DF_INFO *));
+extern int	dff_DbfLength P_((char *));
+extern void	dff_BatchAdd P_((DF_INFO *, char *));
+extern void	dff_BatchExpand P_((DF_INFO *, char *));
+extern void	dff_BatchSize P_((DF_INFO *, DF_BATCH *));
+extern int	dff_CompareBatch P_((const void *, const void *));
+extern int	dff_CompareName P_((const void *, const void *));
+extern int	dff_BatchConvert P_((DF_INFO *));
+extern void	dff_BatchFile P_((DF_INFO *, DF_BATCH *));
+extern int	dff_BatchTake P_((DF_WORKER *));
+extern void	*dff_BatchWorker P_((void *));
+extern void	dff_Batch P_((DF_INFO *));
 extern void	dff_Usage P_((void));
 extern void	dff_DecodeArgs P_((DF_INFO *, int, char *[]));
 extern void	main P_((int, char *[]));
 /*
 	dBase-ish routines.
  */
+extern char	*dBase_MapFile P_((FILE *, long *));
+extern void	dBase_UnmapFile P_((char *, long));
+extern char	*dBase_GetRecord P_((DF_INFO *));
+extern int	dBase_ReadAt P_((FILE *, char *, long, long));
+extern int	dBase_CacheSlot P_((DF_CACHE *, long, int));
+extern char	*dBase_MemoBytes P_((DF_INFO *, long, long *));
+extern int	dBase_CompareLong P_((const void *, const void *));
+extern void	dBase_Prefetch P_((DF_INFO *));
+extern void	dBase_InitMemos P_((DF_INFO *));
+extern long	dBase_MemoAddr P_((DF_INFO *, char *, int));
+extern int	dBase_MemoRead P_((DF_INFO *, long, char *, int));
+extern FILE	*dBase_SpoolFile P_((DF_INFO *, FILE *));
+extern FILE	*dBase_OpenFile P_((DF_INFO *, char *, int));
+extern FILE	*dBase_Unzip P_((DF_INFO *, FILE *, int));
+extern FILE	*dBase_OpenStream P_((DF_INFO *, FILE *));
+extern void	dBase_Close P_((DF_INFO *));
+extern void	dBase_OpenMemos P_((DF_INFO *, int));
+extern int	dBase_FindField P_((DF_INFO *, char *, int));
+extern void	dBase_Project P_((DF_INFO *));
+extern void	dBase_CompilePlan P_((DF_INFO *));
+extern void	dBase_RangeKey P_((DF_INFO *, char *, int, DF_BOUND *));
+extern int	dBase_CompareBound P_((const void *, const void *));
+extern void	dBase_Sample P_((DF_INFO *));
+extern int	dBase_SplitKey P_((DF_INFO *, char *));
+extern int	dBase_KeyPart P_((DF_INFO *, char *, int));
+extern int	dBase_Number P_((char *, int, char *));
+extern int	dBase_NumberParts P_((char *, int, DF_NUM *));
+extern int	dBase_FilterNumber P_((char *, int, DF_NUM *));
+extern int	dBase_CompareNumber P_((DF_NUM *, DF_NUM *));
+extern int	dBase_CompareText P_((char *, int, char *, int));
+extern void	dBase_FilterError P_((DF_INFO *, char *, char *));
+extern int	dBase_FilterTest P_((DF_INFO *, char **));
+extern int	dBase_FilterAnd P_((DF_INFO *, char **));
+extern int	dBase_FilterOr P_((DF_INFO *, char **));
+extern void	dBase_CompileFilter P_((DF_INFO *));
+extern int	dBase_Filter P_((DF_INFO *, int, char *));
+extern long	dBase_MemoHead P_((DF_INFO *, char *));
 extern void	dBase_ProcessMemo P_((DF_INFO *, long));
+extern int	dBase_DecodeStep P_((DF_STEP *, char *, char *));
 extern void	dBase_ProcessRecord P_((DF_INFO *));
+extern int	dBase_JobRoom P_((DF_JOB *, long));
+extern char	*dBase_JobMemoBytes P_((DF_JOB *, long, long *));
+extern int	dBase_JobMemo P_((DF_JOB *, DF_JOBMEMO *, long));
+extern void	dBase_JobRead P_((DF_JOB *, int));
+extern char	*dBase_JobRecord P_((DF_JOB *, long));
+extern void	dBase_JobConvert P_((DF_JOB *));
+extern void	dBase_JobLayout P_((DF_JOB *));
+extern void	dBase_JobFormat P_((DF_JOB *));
+extern void	*dBase_JobThread P_((void *));
+extern void	dBase_RunJobs P_((DF_JOB *, int, int));
+extern DF_JOB	*dBase_NewJobs P_((DF_INFO *, int));
+extern void	dBase_FreeJobs P_((DF_JOB *, int));
+extern void	dBase_JobsOut P_((DF_INFO *, DF_JOB *, int));
+extern void	dBase_ConvertParallel P_((DF_INFO *));
+extern int	dff_RingPut P_((DF_INFO *, DF_RING *, DF_JOB *));
+extern DF_JOB	*dff_RingGet P_((DF_INFO *, DF_RING *));
+extern void	*dBase_ReadStage P_((void *));
+extern void	*dBase_ConvertStage P_((void *));
+extern void	dBase_StopStages P_((DF_INFO *));
+extern void	dBase_ConvertPipelined P_((DF_INFO *));
+extern void	dBase_ConvertMerged P_((DF_INFO *, DF_INFO **, int));
+extern int	dBase_SameFields P_((DF_INFO *, DF_INFO *));
 extern void	dBase_Init P_((DF_INFO *));
 #undef	P_
 
 #define	CheckDiskSpace(d, f) \
 	if (ferror(f) != 0) dff_OutOfSpace(d)
+#define	FieldName(d, i)	((d)->fld_name + ((i) * (DBASE_FLD_NAME_LEN + 1)))
 
 /*+
 	dff_CleanUp()
@@ -286,13 +1074,16 @@ extern void	dBase_Init P_((DF_INFO *));
 		called when horrible things happen, such as out of disk
 		space, or dBase file corruption is detected.
 		clean up and files created during the conversion and exit.
-		returns exit code `status' to the OS.
+		returns exit code `status' to the OS, or for a -b file,
+		`status' + 1 to dff_BatchConvert().
 
 	Calls
 		System
-			fclose(), fprintf(), free(), exit().
+			fclose(), fprintf(), longjmp(), exit().
 		Local
-			dff_DFTtoDFA().
+			dBase_StopStages(), dff_ClosePart(), dff_IoEnd(),
+			dff_DFTtoDFA(), dff_WriteCheckpoint(),
+			dBase_Close(), dff_FreeInfo().
 
 	Alters
 		Incoming
@@ -305,47 +1096,114 @@ void	dff_CleanUp(d, status)
 DF_INFO	*d;
 int	status;
 {
+	int	i;
+
 	/*
-		close all open files.
+		stop any -l threads, then close all open files.
 	 */
-	if (d->dff != (FILE *)NULL) fclose(d->dff);
-	if (d->dfa != (FILE *)NULL) fclose(d->dfa);
+	dBase_StopStages(d);
+	for (i = 0 ; i < d->num_parts ; i++)
+		dff_ClosePart(d, i, status);
+	dff_IoEnd(d);
 	if (d->dfh != (FILE *)NULL) fclose(d->dfh);
 	if (d->dfw != (FILE *)NULL) fclose(d->dfw);
 	if (d->hlp != (FILE *)NULL) fclose(d->hlp);
-	if (d->dbf != (FILE *)NULL) fclose(d->dbf);
-	if (d->dbt != (FILE *)NULL) fclose(d->dbt);
+	dBase_Close(d);
 
 	{
 		long	num_converted = 0;
 
-		for (d->indx = 0 ; d->indx < (d->split == DF_NOT_SPLIT ?
-			1 : DF_MAX_SPLIT) ; d->indx++)
+		for (d->indx = 0 ; d->indx < d->num_parts ; d->indx++) {
 			/*
 				add the Dfile header to the .dfa file(s).
 			 */
+			d->cur = &d->part[d->indx];
 			num_converted += dff_DFTtoDFA(d, status);
+		}
+		if (status == DF_SUCCESS && FLAG_SET(d->flags.incremental))
+			dff_WriteCheckpoint(d, d->num_records, 1);
+		else if (status == DF_SUCCESS && d->ckp_recs > 0L)
+			/*
+				done; -r has nothing to pick up.
+			 */
+			unlink(dff_FileAndExt(d, d->out_file, DF_CKP_EXT));
 
 		if (status == DF_FAILURE) {
-			if (FLAG_SET(d->flags.help))
+			/*
+				an -i run that picked up from its
+				checkpoint, or a -c run that wrote one,
+				leaves the files it found.
+			 */
+			int	keep = (d->start_rec > 0L || d->saved_rec > 0L);
+
+			if (FLAG_SET(d->flags.help) && !keep)
 				/*
 					remove the generated help file.
 				 */
-				unlink(dff_FileAndExt(d->model, DF_HLP_EXT));
-			if (FLAG_SET(d->flags.headers))
+				unlink(dff_FileAndExt(d, d->model, DF_HLP_EXT));
+			if (FLAG_SET(d->flags.headers) && !keep)
 				/*
 					remove the generated header file.
 				 */
-				unlink(dff_FileAndExt(d->model, DF_HDR_EXT));
-			fprintf(stderr, "%s: exiting after %ld/%ld records.\n",
-				PROGNAME, d->rec_num, d->num_records);
+				unlink(dff_FileAndExt(d, d->model, DF_HDR_EXT));
+			if (d->key_how == DF_KEY_RANGE && !keep)
+				/*
+					remove the range manifest.
+				 */
+				unlink(dff_FileAndExt(d, d->model, DF_RNG_EXT));
+			if (d->bail != (jmp_buf *)NULL)
+				fprintf(stderr,
+					"%s: %s: exiting after %ld/%ld records.\n",
+					PROGNAME, d->in_file, d->rec_num,
+					d->num_records);
+			else
+				fprintf(stderr,
+					"%s: exiting after %ld/%ld records.\n",
+					PROGNAME, d->rec_num, d->num_records);
+			if (d->saved_rec > 0L)
+				fprintf(stderr,
+					"%s: %s.%s has %ld records; -r goes on from there.\n",
+					PROGNAME, d->out_file, DF_CKP_EXT,
+					d->saved_rec);
 		} else if (FLAG_NOT_SET(d->flags.terse))
 			printf("%s:%ld dBase records -> Dfile format\n",
 				PROGNAME, num_converted);
+		d->converted = num_converted;
 	}
 	/*
 		be extra-nice.
 	 */
+	dff_FreeInfo(d);
+
+	if (d->bail != (jmp_buf *)NULL)
+		/*
+			a -b file: back to dff_BatchConvert().
+		 */
+		longjmp(*d->bail, status + 1);
+	exit(status);
+}
+
+/*+
+	dff_FreeInfo()
+
+	Parameters
+		`d' is the info struct.
+
+	Description
+		free what dBase_Init() and the conversion allocated.
+
+	Calls
+		System
+			free().
+
+	History
+		ag	16 oct 26
+ +*/
+void	dff_FreeInfo(d)
+DF_INFO	*d;
+{
+	int	i;
+
 	if (d->fld_type != (int *)NULL) free(d->fld_type);
 	if (d->fld_dec != (int *)NULL) free(d->fld_dec);
 	if (d->fld_len != (int *)NULL) free(d->fld_len);
@@ -353,19 +1211,38 @@ int	status;
 	if (d->rec_buffer != (char *)NULL) free(d->rec_buffer);
 	if (d->out_buffer != (char *)NULL) free(d->out_buffer);
 	if (d->memo_buffer != (char *)NULL) free(d->memo_buffer);
-
-	exit(status);
+	if (d->peek_buffer != (char *)NULL) free(d->peek_buffer);
+	if (d->dbf_head != (char *)NULL) free(d->dbf_head);
+	if (d->memo_off != (int *)NULL) free(d->memo_off);
+	if (d->plan != (DF_STEP *)NULL) free((char *)d->plan);
+	for (i = 0 ; i < d->num_parts ; i++)
+		if (d->part[i].name != (char *)NULL) free(d->part[i].name);
+	if (d->part != (DF_PART *)NULL) free((char *)d->part);
+	if (d->part_hash != (int *)NULL) free((char *)d->part_hash);
+	for (i = 0 ; i < d->num_bounds ; i++) free(d->bound[i].text);
+	if (d->bound != (DF_BOUND *)NULL) free((char *)d->bound);
+	if (d->proj != (int *)NULL) free((char *)d->proj);
+	if (d->filter != (DF_TEST *)NULL) free((char *)d->filter);
+	if (d->fld_name != (char *)NULL) free(d->fld_name);
+	if (d->cache != (DF_CACHE *)NULL) {
+		free((char *)d->cache->block);
+		free(d->cache->data);
+		free(d->cache->stage);
+		free((char *)d->cache);
+	}
 }
 
 /*+
 	dff_FileAndExt()
 
 	Parameters
+		`d' is the info struct.
 		`file' is the basename of the file.
 		`ext' is the file extension.
 
 	Description
-		append `ext' to `file' and return a ptr to static space.
+		append `ext' to `file' and return a ptr to space in
+		`d', so -b conversions do not share it.
 
 	Calls
 		System
@@ -373,18 +1250,74 @@ int	status;
 
 	Return Values
 		Explicit
-			returns a pointer to static space.
+			returns a pointer to `d->file_name'.
 
 	History
 		dw	15 dec 92
  +*/
-char    *dff_FileAndExt(file, ext)
+char    *dff_FileAndExt(d, file, ext)
+DF_INFO	*d;
 char    *file,
 	*ext;
 {
-	static char     tmp[100];
-	sprintf(tmp, "%s.%s", file, ext);
-	return (char *)tmp;
+	sprintf(d->file_name, "%.*s.%s", DF_NAME_LEN - 8, file, ext);
+	return d->file_name;
+}
+
+/*+
+	dff_FindDbase()
+
+	Parameters
+		`d' is the info struct.
+		`file' is the basename of a dBase or memo file.
+		`ext' is its (lower case) extension.
+
+	Description
+		find which of `file'.`ext', `file'.`EXT' (as DOS
+		wrote them), and those with .gz when gzip'd files can
+		be read, is there.
+
+	Calls
+		System
+			sprintf(), stat(), toupper().
+
+	Return Values
+		Explicit
+			returns a pointer to `d->file_name', or NULL if
+			there is none.
+
+	History
+		ag	16 oct 26
+ +*/
+char	*dff_FindDbase(d, file, ext)
+DF_INFO	*d;
+char	*file,
+	*ext;
+{
+#ifdef	DF_HAVE_MMAP
+	struct stat	st;
+	char	up[8];
+	int	i, gz;
+
+	for (i = 0 ; ext[i] != '\0' && i < (int)sizeof(up) - 1 ; i++)
+		up[i] = (char)toupper(ext[i]);
+	up[i] = '\0';
+#ifdef	DF_HAVE_ZLIB
+	for (gz = 0 ; gz < 2 ; gz++)
+#else
+	for (gz = 0 ; gz < 1 ; gz++)
+#endif
+		for (i = 0 ; i < 2 ; i++) {
+			sprintf(d->file_name, "%.*s.%s%s", DF_NAME_LEN - 12,
+				file, (i == 0 ? ext : up),
+				(gz ? DF_GZ_SUFFIX : ""));
+			if (stat(d->file_name, &st) == 0)
+				return d->file_name;
+		}
+	return (char *)NULL;
+#else
+	return dff_FileAndExt(d, file, ext);
+#endif
 }
 
 /*+
@@ -396,17 +1329,16 @@ char    *file,
 
 	Description
 		return a file name for the correct file as determined
-		by the value of `d->indx'.
+		by the value of `d->indx'.  -z adds DF_GZ_SUFFIX to
+		the .dff and .dfa.
 
 	Calls
 		System
-			strcpy(), sprintf().
-		Local
-			dff_FileAndExt().
+			sprintf(), strcmp().
 
 	Return Values
 		Explicit
-			returns ptr to static space.
+			returns a pointer to `d->dfile_name'.
 
 	History
 		dw	15 dec 92
@@ -415,16 +1347,12 @@ char	*dff_GenDfilename(d, ext)
 DF_INFO	*d;
 char	*ext;
 {
-	static char     tmp[100];
-	if (d->split == DF_NOT_SPLIT)
-		strcpy(tmp, dff_FileAndExt(d->out_file, ext));
-	else if (d->indx == DF_NUMBER_FILE)
-		strcpy(tmp, dff_FileAndExt(DF_NUMBER_NAME, ext));
-	else if (d->indx == DF_OTHER_FILE)
-		strcpy(tmp, dff_FileAndExt(DF_OTHER_NAME, ext));
-	else
-		sprintf(tmp, "%c.%s", d->indx + 'a', ext);
-	return (char *)tmp;
+	sprintf(d->dfile_name, "%.*s.%s%s", DF_NAME_LEN - 8,
+		(d->split == DF_NOT_SPLIT ? d->out_file :
+		d->part[d->indx].name), ext,
+		(FLAG_SET(d->flags.zip) && (strcmp(ext, DF_DF_EXT) == 0 ||
+		strcmp(ext, DF_ADR_EXT) == 0) ? DF_GZ_SUFFIX : ""));
+	return d->dfile_name;
 }
 
 /*+
@@ -485,640 +1413,6511 @@ int	bytes;
 }
 
 /*+
-	dff_Open()
+	dff_GetBytes()
 
 	Parameters
-		`d' is the info struct.
+		`fp' is the dBase file.
+		`bytes' is the number of bytes (up to 4) to read.
 
 	Description
-		open the .dff and .dft file pair specified by `d->indx'.
-		Dfile record starting block information is written to
-		.dft temp files which are converted to .dfa files by
-		dff_DFTtoDFA() upon successful conversion of the entire
-		dBase file.
+		read a little-endian number from the dBase header,
+		for GetInt() and GetLong().
 
 	Calls
 		System
-			fopen(), fprintf().
+			fread().
 		Local
-			CheckDiskSpace().
+			dff_BytesToLong().
 
-	Alters
-		Incoming
-			`d->dff', `d->dfa'
+	Return Values
+		Explicit
+			returns the number.
 
 	History
-		dw	15 dec 92
+		ag	16 oct 26
  +*/
-void	dff_Open(d)
-DF_INFO	*d;
+long	dff_GetBytes(fp, bytes)
+FILE	*fp;
+int	bytes;
 {
-	if ((d->dff = fopen(dff_GenDfilename(d, DF_DF_EXT),
-		(d->logical[d->indx] > 0L ?
-		"a+" : "w"))) == (FILE *)NULL) dff_OutOfSpace(d);
-	if ((d->dfa = fopen(dff_GenDfilename(d, DF_TMP_EXT),
-		(d->logical[d->indx] > 0L ?
-		"a+" : "w"))) == (FILE *)NULL) dff_OutOfSpace(d);
+	char	byte[4];
 
-	if (d->logical[d->indx] == 0L) {
-		/*
-			this is the first time this file has been opened;
-			output the FreeList information.
-			NOTE: the created .dff file must have the same
-			Model name as the .dfh file.
-		 */
-		fprintf(d->dff, "Version={%s} Model={%s}%*d\n",
-			DF_VERSION_STRING, d->model,
-			(DF_REC_WIDTH - (26 + strlen(d->model))) +
-			DF_ADDR_WIDTH, DF_FREELIST);
-		CheckDiskSpace(d, d->dff);
-	}
+	(void)fread(byte, 1, (size_t)bytes, fp);
+	return dff_BytesToLong(byte, bytes);
 }
 
 /*+
-	dff_WriteBlocks()
+	dff_PutBytes()
+
+	Parameters
+		`fp' is the file to write to.
+		`value' is the number, not negative.
+		`bytes' is the number of bytes (up to 8) to write.
+
+	Description
+		write a little-endian number, for the -x .dfx file.
+		bytes past those of a long are written as 0.
+
+	Calls
+		System
+			putc().
+
+	History
+		ag	16 oct 26
+ +*/
+void	dff_PutBytes(fp, value, bytes)
+FILE	*fp;
+long	value;
+int	bytes;
+{
+	for ( ; bytes > 0 ; bytes--, value >>= 8)
+		(void)putc((int)(value & 0xff), fp);
+}
+
+/*+
+	dff_IoInit()
 
 	Parameters
 		`d' is the info struct.
-		`ptr' holds an already-Dfile-formatted string.
-		`which' is either DF_WRITING_RECORD or DF_WRITING_MEMO.
 
 	Description
-		writes the field-delimited string in the Dfile format
-		to the .dff file and bumps the block pointer by the
-		number of blocks written.
+		set up the io_uring used to queue output writes.
+		if this kernel (or its security policy) has no io_uring,
+		`d->io' is left NULL and the outputs are written with
+		plain pwrite() calls instead.
 
 	Calls
 		System
-			strlen(), strncpy(), fprintf().
-		Local
-			dff_TrimText(), dff_Open(), CheckDiskSpace().
+			syscall(), mmap(), munmap(), close(), malloc(), free().
 
 	Alters
 		Incoming
-			`d->dff', `d->physical[d->indx]'.
-
-	Return Values
-		Explicit
-			returns exit code to the OS.
+			`d->io'.
 
 	History
-		dw	15 dec 92
+		ag	16 oct 26
  +*/
-void	dff_WriteBlocks(d, ptr, which)
+void	dff_IoInit(d)
 DF_INFO	*d;
-char	*ptr;
 {
-	int	len;
+#ifdef	DF_HAVE_IO_URING
+	struct io_uring_params	p;
+	DF_IO	*io;
+	int	i;
 
-	if (d->dff == (FILE *)NULL)
-		/*
-			open the output files if not already open.
-		 */
-		dff_Open(d);
+	d->io = (DF_IO *)NULL;
+	memset((char *)&p, 0, sizeof(p));
+	if ((io = (DF_IO *)malloc(sizeof(DF_IO))) == (DF_IO *)NULL)
+		return;
+	memset((char *)io, 0, sizeof(DF_IO));
+	if ((io->fd = (int)syscall(__NR_io_uring_setup,
+		DF_IO_DEPTH, &p)) < 0) {
+		free((char *)io);
+		return;
+	}
 
-	if (which == DF_WRITING_RECORD) {
-		/*
-			write the starting record block to the .dft file.
-		 */
-		fprintf(d->dfa, "%c%ld\t%ld\n",
-			(FLAG_SET(d->flags.protect_recs) ? '-' : ' '),
-			++(d->logical[d->indx]), d->physical[d->indx] + 1L);
-		CheckDiskSpace(d, d->dfa);
+	io->sq_map_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	io->cq_map_len = p.cq_off.cqes +
+		p.cq_entries * sizeof(struct io_uring_cqe);
+	io->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+	if ((p.features & IORING_FEAT_SINGLE_MMAP) &&
+		io->cq_map_len > io->sq_map_len)
+		io->sq_map_len = io->cq_map_len;
+	io->sq_map = mmap((void *)NULL, io->sq_map_len,
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+		io->fd, IORING_OFF_SQ_RING);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		io->cq_map = io->sq_map;
+		io->cq_map_len = 0;
 	} else
-		/*
-			remove special dBase chars and get into smallest space.
-		 */
-		dff_TrimText(&ptr);
-
-	len = strlen(ptr);
-
-	while (len > DF_REC_WIDTH) {
-		/*
-			split the formatted string into Dfile blocks.
-		 */
-		char	buffer[DF_REC_WIDTH + 1];
-		strncpy(buffer, ptr, DF_REC_WIDTH);
-		buffer[DF_REC_WIDTH] = '\0';
-		fprintf(d->dff, "%s%*ld\n", buffer, DF_ADDR_WIDTH,
-			(++(d->physical[d->indx]) + 1L));
-		ptr += DF_REC_WIDTH;
-		len -= DF_REC_WIDTH;
+		io->cq_map = mmap((void *)NULL, io->cq_map_len,
+			PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			io->fd, IORING_OFF_CQ_RING);
+	io->sqes = (struct io_uring_sqe *)mmap((void *)NULL, io->sqes_len,
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+		io->fd, IORING_OFF_SQES);
+	if (io->sq_map == MAP_FAILED || io->cq_map == MAP_FAILED ||
+		(void *)io->sqes == MAP_FAILED) {
+		if (io->sq_map != MAP_FAILED)
+			munmap(io->sq_map, io->sq_map_len);
+		if (io->cq_map != MAP_FAILED && io->cq_map_len != 0)
+			munmap(io->cq_map, io->cq_map_len);
+		if ((void *)io->sqes != MAP_FAILED)
+			munmap((void *)io->sqes, io->sqes_len);
+		close(io->fd);
+		free((char *)io);
+		return;
 	}
-	fprintf(d->dff, "%s%*d\n", ptr,
-		(DF_REC_WIDTH - len) + DF_ADDR_WIDTH, DF_REC_END);
-	CheckDiskSpace(d, d->dff);
-	++(d->physical[d->indx]);
+	io->sq_head = (unsigned *)((char *)io->sq_map + p.sq_off.head);
+	io->sq_tail = (unsigned *)((char *)io->sq_map + p.sq_off.tail);
+	io->sq_mask = (unsigned *)((char *)io->sq_map + p.sq_off.ring_mask);
+	io->sq_array = (unsigned *)((char *)io->sq_map + p.sq_off.array);
+	io->cq_head = (unsigned *)((char *)io->cq_map + p.cq_off.head);
+	io->cq_tail = (unsigned *)((char *)io->cq_map + p.cq_off.tail);
+	io->cq_mask = (unsigned *)((char *)io->cq_map + p.cq_off.ring_mask);
+	io->cqes = (struct io_uring_cqe *)((char *)io->cq_map +
+		p.cq_off.cqes);
+	for (i = 0 ; i < DF_IO_DEPTH ; i++)
+		io->slot[i].buffer = (char *)malloc(DF_OUT_BUFSIZE);
+	d->io = io;
+#else
+	(void)d;
+#endif
 }
 
 /*+
-	dff_StripString()
+	dff_IoWait()
 
 	Parameters
-		`str' points to the string to strip.
-		`len' is the length of the string.
+		`d' is the info struct.
+		`all' is non-zero to wait for every queued write,
+			zero to wait for at least one.
+		`status' is DF_FAILURE when cleaning up after an error;
+			write errors are then ignored.
 
 	Description
-		removes leading and trailing spaces from `ptr'.
+		reap completed io_uring writes and free their slots.
+		a short write is finished off with pwrite(); one that
+		gets no further fails as a write error does.
 
-	Alters
-		Incoming
-			`ptr'.
-
-	Return Values
-		Explicit
-			length of stripped `ptr'.
+	Calls
+		System
+			syscall(), pwrite().
+		Local
+			dff_OutOfSpace().
 
 	History
-		dw	15 dec 92
+		ag	16 oct 26
  +*/
-int	dff_StripString(str, len)
-char	**str;
-int	len;
+void	dff_IoWait(d, all, status)
+DF_INFO	*d;
+int	all,
+	status;
 {
-	/*
-		remove leading and trailing whitespace.
-	 */
-	while (len > 0 && ((*str)[len - 1] == ' ' ||
-		(*str)[len - 1] == DF_DELIM)) (*str)[--len] = '\0';
-	while ((*str)[0] == ' ') (*str)++;
+#ifdef	DF_HAVE_IO_URING
+	DF_IO	*io = d->io;
+	int	reaped = 0;
 
-	return len;
+	if (io == (DF_IO *)NULL) return;
+
+	while (io->in_flight > 0 && (all || reaped == 0)) {
+		unsigned	head = *io->cq_head;
+
+		if (head == __atomic_load_n(io->cq_tail, __ATOMIC_ACQUIRE)) {
+			syscall(__NR_io_uring_enter, io->fd, 0, 1,
+				IORING_ENTER_GETEVENTS, NULL, 0);
+			continue;
+		}
+		while (head != __atomic_load_n(io->cq_tail, __ATOMIC_ACQUIRE)) {
+			struct io_uring_cqe *cqe =
+				&io->cqes[head & *io->cq_mask];
+			int	i = (int)cqe->user_data,
+				res = cqe->res;
+
+			head++;
+			if (res >= 0 && res < (int)io->slot[i].iov.iov_len) {
+				/*
+					finish a short write in line.
+				 */
+				char	*ptr = io->slot[i].buffer + res;
+				long	left = (long)io->slot[i].iov.iov_len -
+						res,
+					off = io->slot[i].offset + res;
+				while (left > 0 && (res = (int)pwrite(
+					io->slot[i].fd, ptr, (size_t)left,
+					(off_t)off)) > 0) {
+					ptr += res; off += res; left -= res;
+				}
+				if (left > 0)
+					res = -1;	/* no progress */
+			}
+			io->slot[i].busy = 0;
+			io->in_flight--;
+			reaped++;
+			if (res < 0 && status == DF_SUCCESS) {
+				__atomic_store_n(io->cq_head, head,
+					__ATOMIC_RELEASE);
+				dff_OutOfSpace(d);
+			}
+		}
+		__atomic_store_n(io->cq_head, head, __ATOMIC_RELEASE);
+	}
+#else
+	(void)d; (void)all; (void)status;
+#endif
 }
 
 /*+
-	dff_TrimText()
+	dff_WriteAt()
 
 	Parameters
-		`ptr' is the Dfile string to trim.
+		`fd' is an output file.
+		`ptr' holds `len' bytes to write at offset `off', or
+			where the file is if `off' is -1.
 
 	Description
-		removes non-ASCII characters from dBase strings,
-		removes multiple spaces and line feeds from the string
-		in preparation for use by dff_WriteBlocks().
+		write all of `ptr' with pwrite() (or lseek()+write()
+		where there is no pwrite()).  -j threads write their
+		.dff blocks with this.  a pipe is written with write().
 
 	Calls
 		System
-			isascii(), isspace(), isprint().
-		Local
-			dff_StripString().
+			pwrite(), lseek(), write().
 
-	Alters
-		Incoming
-			`ptr'.
+	Return Values
+		Explicit
+			returns the number of bytes written, or -1.
 
 	History
-		dw	15 dec 92
+		ag	16 oct 26
  +*/
-void	dff_TrimText(ptr)
-char	**ptr;
+long	dff_WriteAt(fd, ptr, len, off)
+int	fd;
+char	*ptr;
+long	len,
+	off;
 {
-	int	i, len;
+	long	total = 0L;
 
-	/*
-		translate end-of field markers
-		and remove non-ascii dBase characters.
-	 */
-	for (i = 0 ; (*ptr)[i] != '\0' && (*ptr)[i] != DBASE_MEMO_END &&
-		(*ptr)[i + 1] != DBASE_MEMO_END ; i++)
-		if ((*ptr)[i] == DBASE_LINE_FEED || (*ptr)[i] == DBASE_CARRIAGE)
-			(*ptr)[i] = DF_DELIM;
-		else if (!isascii((*ptr)[i]) ||
-			isspace((*ptr)[i]) || !isprint((*ptr)[i]))
-			(*ptr)[i] = ' ';
-	(*ptr)[(len = i) + 1] = '\0';
-	len = dff_StripString(ptr, len);
+	while (len > 0L) {
+		long	n;
 
-	/*
-		remove multiple blank lines and end-of-fields.
-	 */
-	for (i = 0 ; i < len ; i++)
-		while (i < len && ((*ptr)[i] == DF_DELIM || (*ptr)[i] == ' ') &&
-			((*ptr)[i + 1] == DF_DELIM || (*ptr)[i + 1] == ' ')) {
-			int	l;
-			for (l = i ; l < len ; l++)
-				(*ptr)[l] = (*ptr)[l + 1];
-			(*ptr)[len--] = '\0';
+		if (off < 0L)
+			n = (long)write(fd, ptr, (unsigned)len);
+		else {
+#ifdef	DF_HAVE_PWRITE
+			n = (long)pwrite(fd, ptr, (size_t)len, (off_t)off);
+#else
+			n = (lseek(fd, off, 0) == off ?
+				(long)write(fd, ptr, (unsigned)len) : -1L);
+#endif
 		}
+		if (n <= 0L) return -1L;
+		ptr += n; len -= n; total += n;
+		if (off >= 0L) off += n;
+	}
+	return total;
 }
 
 /*+
-	dBase_ProcessMemo()
+	dff_IoWrite()
 
 	Parameters
 		`d' is the info struct.
-		`addr' is the dBase memo address.
+		`out' is the output whose buffer is written.
+		`status' is DF_FAILURE when cleaning up after an error.
 
 	Description
-		reads the dBase memo into a buffer which is passed
-		onto dff_TrimText() for processing.  then calls
-		dff_WriteBlocks() to add the memo text to the .dff file.
+		write the buffered bytes of `out' at its file offset.
+		with an io_uring the buffer is handed to a free slot and
+		queued, and `out' carries on with the slot's spare buffer;
+		otherwise the bytes are written with pwrite() (or
+		lseek()+write() where there is no pwrite()).  stdout
+		is written in order, with write().
 
 	Calls
 		System
-			fseek(), fread().
+			syscall().
 		Local
-			dff_WriteBlocks().
+			dff_IoWait(), dff_IoEnd(), dff_WriteAt(),
+			dff_OutOfSpace().
 
 	Alters
 		Incoming
-			`d'.
-
-	Return Values
-		Explicit
-			returns exit code to the OS.
+			`out'.
 
 	History
-		dw	15 dec 92
+		ag	16 oct 26
  +*/
-void	dBase_ProcessMemo(d, addr)
+void	dff_IoWrite(d, out, status)
 DF_INFO	*d;
-long	addr;
+DF_OUT	*out;
+int	status;
 {
-	char	*ptr = d->memo_buffer;
+	char	*ptr = out->buffer;
+	long	left = (long)out->used,
+		off = (out->seq ? -1L : out->offset);
+
+	if (left == 0L) return;
+	out->offset += left;
+	out->used = 0;
+
+#ifdef	DF_HAVE_IO_URING
+	if (d->io != (DF_IO *)NULL && !out->seq) {
+		DF_IO	*io = d->io;
+		int	i;
 
-	if (d->dbt == (FILE *)NULL ||
-		fseek(d->dbt, addr * (long)DBASE_MEMO_BLOCK, 0) != 0)
+		while (io->in_flight >= DF_IO_DEPTH)
+			dff_IoWait(d, 0, status);
+		for (i = 0 ; io->slot[i].busy ; i++)
+			;
+		if (io->slot[i].buffer != (char *)NULL) {
+			unsigned		tail = *io->sq_tail,
+						indx = tail & *io->sq_mask;
+			struct io_uring_sqe	*sqe = &io->sqes[indx];
+
+			out->buffer = io->slot[i].buffer;
+			io->slot[i].buffer = ptr;
+			io->slot[i].busy = 1;
+			io->slot[i].fd = out->fd;
+			io->slot[i].offset = off;
+			io->slot[i].iov.iov_base = (void *)ptr;
+			io->slot[i].iov.iov_len = (size_t)left;
+
+			memset((char *)sqe, 0, sizeof(*sqe));
+			sqe->opcode = IORING_OP_WRITEV;
+			sqe->fd = out->fd;
+			sqe->off = (unsigned long long)off;
+			sqe->addr = (unsigned long long)(unsigned long)
+				&io->slot[i].iov;
+			sqe->len = 1;
+			sqe->user_data = (unsigned long long)i;
+			io->sq_array[indx] = indx;
+			__atomic_store_n(io->sq_tail, tail + 1,
+				__ATOMIC_RELEASE);
+			io->in_flight++;
+			if (syscall(__NR_io_uring_enter, io->fd, 1, 0, 0,
+				NULL, 0) == 1)
+				return;
 			/*
-				either there *was* a memo field when no
-				memos were specified by the .dbf magic cookie,
-				or the address of the memo field is invalid.
-				ignore the memo field for both cases.
+				the ring refused the write; drop back to
+				pwrite() for this and all later writes.
 			 */
-			return;
-
-	{
-		/*
-			read several MEMO blocks at a time.
-			NOTE: if the MEMO field is more than
-			DF_MAX_MEMO_SIZE long, it is truncated.
-		 */
-		int	bytes_read = fread(ptr, 1, DF_MAX_MEMO_SIZE, d->dbt);
-		if (bytes_read == -1) {
-			fprintf(stderr,
-				"%s: couldn't read memo for record %ld\n",
-				PROGNAME, d->rec_num + 1);
-			dff_CleanUp(d, DF_FAILURE);
+			__atomic_store_n(io->sq_tail, tail, __ATOMIC_RELEASE);
+			io->slot[i].busy = 0;
+			io->in_flight--;
+			dff_IoEnd(d);
 		}
-		ptr[bytes_read] = '\0';
 	}
-	dff_WriteBlocks(d, ptr, DF_WRITING_MEMO);
+#endif
+
+	if (dff_WriteAt(out->fd, ptr, left, off) < 0L && status == DF_SUCCESS)
+		dff_OutOfSpace(d);
 }
 
 /*+
-	dBase_ProcessRecord()
+	dff_IoEnd()
 
 	Parameters
 		`d' is the info struct.
 
 	Description
-		reads the next dBase record and processes all of its
-		fields, then writes them to the .dff file and updates
-		the .dfa file with the starting .dff block of the Dfile record.
+		wait for queued writes and tear down the io_uring.
 
 	Calls
 		System
-			fseek(), fread(), fprintf(), printf(), strncpy(),
-			atof(), atol(), sprintf(), fclose(), isdigit(),
-			tolower(), strcat(), fflush().
+			munmap(), close(), free().
 		Local
-			dff_CleanUp(), dBase_ProcessMemo(), dff_TrimText(),
-			CheckDiskSpace(), dff_WriteBlocks().
+			dff_IoWait().
 
 	Alters
 		Incoming
-			`d'.
+			`d->io'.
 
 	History
-		dw	15 dec 92
+		ag	16 oct 26
  +*/
-void	dBase_ProcessRecord(d)
+void	dff_IoEnd(d)
 DF_INFO	*d;
 {
+#ifdef	DF_HAVE_IO_URING
+	DF_IO	*io = d->io;
 	int	i;
-	char	*ptr = d->rec_buffer;
-	long	rec_start = ftell(d->dbf);
-
-	{
-		int	bytes_read = fread(ptr, 1, d->bytes, d->dbf);
-		if (bytes_read == -1) {
-			fprintf(stderr, "%s: couldn't record %ld\n",
-				PROGNAME, d->rec_num + 1);
-			dff_CleanUp(d, DF_FAILURE);
-		} else if (bytes_read != d->bytes) {
-			fprintf(stderr, "\n%s: record %ld not %d bytes (%d)!\n",
-				PROGNAME, d->rec_num, d->bytes, bytes_read);
-			dff_CleanUp(d, DF_FAILURE);
-		}
-	}
-
-	d->out_buffer[0] = ptr[d->bytes] = '\0';
-
-	if ((int)ptr++ == DBASE_DELETED && FLAG_NOT_SET(d->flags.undel)) {
-		/*
-			not restoring deleted records.
-			return.
-		 */
-		if (FLAG_NOT_SET(d->flags.terse))
-			printf("\n%s: skipping %ld - use -u flag to keep\n",
-				PROGNAME, d->rec_num);
-		return;
-	}
-
-	/*
-		get fields into Dfile format
-	 */
-	for (i = 0 ; i < d->num_flds ; i++) {
-		char	*fld = d->fld_buffer;
-
-		strncpy(fld, ptr, d->fld_len[i]);
-		ptr += d->fld_len[i];
-		fld[d->fld_len[i]] = '\0';
-
-		if (d->fld_type[i] == DBASE_NUMERIC_FLD) {
-			float	val = (float)atof(fld);
-			/*
-				get numbers into smallest
-				possible space.
-			 */
-			if (val == (float)0)
-				/*
-					leave the field blank
-				 */
-				fld[0] = '\0';
-			else
-				sprintf(fld, "%g", val);
-		} else if (d->fld_type[i] == DBASE_MEMO_FLD) {
-			long	old_start = d->physical[d->indx];
-			/*
-				add the memo text to the .dff file
-			 */
-			dBase_ProcessMemo(d, (long)atol(fld));
-			/*
-				add the physical memo address to the memo field.
-			 */
-			sprintf(fld, "%ld",
-				(d->physical[d->indx] == old_start ?
-				DF_FREELIST : old_start + 1L));
-		} else {
-			/*
-				remove special dBase chars and get into
-				smallest space.
-			 */
-			dff_TrimText(&fld);
-
-			if (i == d->split) {
-				int	last = d->indx;
-
-				/*
-					set the indx file as the 1st char
-					of the split field.
-				 */
-				if (isdigit(fld[0]))
-					/*
-						digit fields go into
-						DF_NUMBER_FILE.
-					 */
-					d->indx = DF_NUMBER_FILE;
-				else if ((d->indx =
-					tolower(fld[0]) - 'a') < 0 ||
-					d->indx >= DF_MAX_SPLIT)
-					/*
-						non-alpha go into the
-						DF_OTHER_NAME file.
-					 */
-					d->indx = DF_OTHER_FILE;
-
-				if (last != d->indx && d->dff != (FILE *)NULL) {
-					/*
-						if the field value has changed,
-						re-set the dBase file to the
-						start of this record.  (only if
-						a .dff file is already in use).
-					 */
-					d->rec_num--;
-					fseek(d->dbf, rec_start, 0);
-					fclose(d->dff); fclose(d->dfa);
-					d->dff = d->dfa = (FILE *)NULL;
-					return;
-				}
-			}
-		}
 
-		strcat(d->out_buffer, fld);
-		if (i < d->num_flds - 1)
-			/*
-				the last field is not delimited
-			 */
-			strcat(d->out_buffer, DF_DELIMS);
-	}
-
-	dff_WriteBlocks(d, d->out_buffer, DF_WRITING_RECORD);
-	if (FLAG_NOT_SET(d->flags.terse) && (d->rec_num % d->report) == 0) {
-		/*
-			show percent done.
-		 */
-		static	int	percent_done = 0;
-		printf("%d%% converted\n", percent_done++);
-		fflush(stdout);
-	}
+	if (io == (DF_IO *)NULL) return;
+	dff_IoWait(d, 1, DF_FAILURE);
+	d->io = (DF_IO *)NULL;
+	munmap((void *)io->sqes, io->sqes_len);
+	if (io->cq_map_len != 0) munmap(io->cq_map, io->cq_map_len);
+	munmap(io->sq_map, io->sq_map_len);
+	close(io->fd);
+	for (i = 0 ; i < DF_IO_DEPTH ; i++)
+		if (io->slot[i].buffer != (char *)NULL)
+			free(io->slot[i].buffer);
+	free((char *)io);
+#else
+	(void)d;
+#endif
 }
 
+#ifdef	DF_HAVE_ZLIB
 /*+
-	dff_DFTtoDFA()
+	dff_ZipOpen()
 
 	Parameters
 		`d' is the info struct.
-		`status' is DF_SUCCESS or DF_FAILURE.
+		`zip' is the helper to start.
+		`fd' is the gzip'd file, which the helper takes.
+		`writing' is non-zero to compress what is written,
+		otherwise the file is uncompressed for reading.
 
 	Description
-		creates the .dfa file from the .dft temp file.
+		start a helper thread at the other end of a pipe, so
+		the file is (un)compressed alongside the conversion.
+		SIGPIPE is ignored, so a pipe closed early is only a
+		write error.
 
 	Calls
 		System
-			strcpy(), printf(), fprintf(), fopen(), fclose(),
-			unlink().
+			pipe(), gzdopen(), gzbuffer(), signal(),
+			pthread_create(), fprintf(), strerror().
 		Local
-			dff_GenDfilename(), dff_OutOfSpace(), CheckDiskSpace().
+			dff_ZipThread(), dff_OutOfSpace(), dff_CleanUp().
 
 	Return Values
 		Explicit
-			returns the number of records in the .dfa file.
+			returns our end of the pipe.
 
 	History
-		dw	15 dec 92
+		ag	16 oct 26
  +*/
-long	dff_DFTtoDFA(d, status)
+int	dff_ZipOpen(d, zip, fd, writing)
 DF_INFO	*d;
-int	status;
+DF_ZIP	*zip;
+int	fd,
+	writing;
 {
-	char	adr_file[100],
-		tmp_file[100];
-
-	strcpy(adr_file, dff_GenDfilename(d, DF_ADR_EXT));
-	strcpy(tmp_file, dff_GenDfilename(d, DF_TMP_EXT));
-	
-	if (status == DF_SUCCESS && FLAG_NOT_SET(d->flags.terse))
-		printf("%s has %ld records\n",
-			dff_GenDfilename(d, DF_DF_EXT), d->logical[d->indx]);
+	int	p[2];
 
-	if (status == DF_SUCCESS && d->logical[d->indx] > 0L) {
-		/*
-			add the number of records to the top of the .dfa file.
-		 */
-		int	c;
-		FILE	*tmp = fopen(adr_file, "w");
-		if (tmp == (FILE *)NULL) dff_OutOfSpace(d);
-		d->dfa = fopen(tmp_file, "r");
-		Dfile_WriteComment(tmp, "Dfile Version");
-		fprintf(tmp, "char\tVersion\t{%s}\n", DF_VERSION_STRING);
-		Dfile_WriteComment(tmp, "Dfile Model name");
-		fprintf(tmp, "char\tModel\t{%s}\n", d->model);
-		fprintf(tmp, "char\tFileProtected\t{%s}\n",
-			(FLAG_SET(d->flags.protect_file) ? "yes" : "no"));
-		fprintf(tmp, "long\tNumRecords\t%ld\n", d->logical[d->indx]);
-		Dfile_WriteComment(tmp, "a `-' marks a record as protected");
-		fprintf(tmp, "long\tRecordAddresses[%ld]\n",
-			d->logical[d->indx] * 2L);
-		while ((c = fgetc(d->dfa)) != EOF) fputc(c, tmp);
-		CheckDiskSpace(d, tmp);
-		fclose(d->dfa);
-		fclose(tmp);
-		unlink(tmp_file);
-	} else {
-		/*
-			exiting with DF_FAILURE status or
-			no records for this letter;
-			remove all associated Dfile files.
-		 */
-		unlink(tmp_file);
-		unlink(dff_GenDfilename(d, DF_DF_EXT));
+	if (pipe(p) != 0) {
+		fprintf(stderr, "\n%s: cannot start a gzip helper: %s\n",
+			PROGNAME, strerror(errno));
+		dff_CleanUp(d, DF_FAILURE);
 	}
-
-	return d->logical[d->indx];
+	if ((zip->gz = gzdopen(fd, (writing ?
+		DF_ZIP_MODE : "rb"))) == (gzFile)NULL)
+		dff_OutOfSpace(d);
+	(void)gzbuffer(zip->gz, DF_ZIP_BUFSIZE);
+	(void)signal(SIGPIPE, SIG_IGN);
+	zip->writing = writing;
+	zip->failed = 0;
+	zip->other = p[writing ? 0 : 1];
+	if (pthread_create(&zip->thread, (pthread_attr_t *)NULL,
+		dff_ZipThread, (void *)zip) != 0)
+		dff_OutOfSpace(d);
+	return p[writing ? 1 : 0];
 }
 
 /*+
-	dff_Init()
+	dff_ZipThread()
 
 	Parameters
-		`d' is the info struct.
+		`arg' is the helper.
 
 	Description
-		initialises the Dfile info struct.
+		the gzip helper thread: compress what comes down the
+		pipe into the file, or uncompress the file into the
+		pipe until the reader closes it.
 
-	Alters
-		Incoming
-			`d'.
+	Calls
+		System
+			read(), gzwrite(), gzread(), gzclose(), close().
+		Local
+			dff_WriteAt().
+
+	Return Values
+		Explicit
+			returns NULL.
 
 	History
-		dw	15 dec 92
+		ag	16 oct 26
  +*/
-void	dff_Init(d)
-DF_INFO	*d;
+void	*dff_ZipThread(arg)
+void	*arg;
 {
+	DF_ZIP	*zip = (DF_ZIP *)arg;
+	char	buf[DF_ZIP_BUFSIZE];
+	long	n;
+
+	if (zip->writing) {
+		while ((n = (long)read(zip->other, buf, sizeof(buf))) > 0L)
+			if (gzwrite(zip->gz, buf, (unsigned)n) != (int)n)
+				break;
+		zip->failed = (n != 0L);
+	} else {
+		while ((n = (long)gzread(zip->gz, buf, sizeof(buf))) > 0L)
+			if (dff_WriteAt(zip->other, buf, n, -1L) != n)
+				/*
+					the reader is done.
+				 */
+				break;
+		zip->failed = (n < 0L);
+	}
+	if (gzclose(zip->gz) != Z_OK && zip->writing)
+		zip->failed = 1;
 	/*
-		initialise stuff
+		a writer blocked on a full pipe sees it close.
 	 */
-	d->out_dir = d->model = d->in_file =
-		d->out_file = d->fld_buffer = d->rec_buffer =
-		d->out_buffer = d->memo_buffer = (char *)NULL;
-	d->split = DF_NOT_SPLIT;
-	d->indx = 0;
-	d->flags.help = d->flags.headers =
-		d->flags.protect_recs = d->flags.protect_file =
-		d->flags.undel = d->flags.terse = (unsigned)0;
-	d->hlp = d->dff = d->dfa = d->dfh = d->dfw =
-		d->dbf = d->dbt = (FILE *)NULL;
-	d->rec_num = d->num_records = 0L;
-	{
-		int	i;
-		for (i = 0 ; i < DF_MAX_SPLIT ; i++)
-			d->physical[i] = d->logical[i] = 0L;
-	}
-	d->fld_dec = d->fld_type = d->fld_len = (int *)NULL;
+	close(zip->other);
+	return (void *)NULL;
 }
 
-static char *use[] = {
-	"usage: dbf2dff [-ghpPut -s # -o file -m name] file",
-	"flags:",
-	"g; generate Dfile header file during conversion",
-	"h; generate Dfile help file template during conversion",
-	"p; mark records as \"protected\" from editing via Dfile",
-	"P; mark files as \"protected\" from editing via Dfile",
-	"u; undelete dBase records during conversion",
-	"s #; split into files based on field #",
-	"o file; name an output file",
-	"m model; give a name to a family of converted files",
-	"t; terse/silent conversion",
-	(char *)NULL
-};
-
 /*+
-	dff_Usage()
+	dff_ZipEnd()
 
-	Description
-		called when bad command-line args are used.
-		show em what is valid. exits with code DF_FAILURE.
+	Parameters
+		`zip' is a helper started by dff_ZipOpen(), whose
+		pipe we have closed.
 
 	Calls
 		System
-			fprintf(), fputc(), exit().
+			pthread_join().
+
+	Return Values
+		Explicit
+			returns non-zero if the helper failed.
 
 	History
-		dw	15 dec 92
+		ag	16 oct 26
  +*/
-void	dff_Usage()
+int	dff_ZipEnd(zip)
+DF_ZIP	*zip;
 {
-	int	i = 0;
-	while (use[i] != (char *)NULL) fprintf(stderr, "%s\n\t", use[i++]);
-	fputc('\n', stderr);
-	exit(DF_FAILURE);
+	pthread_join(zip->thread, (void **)NULL);
+	return zip->failed;
 }
+#endif
 
 /*+
-	dff_DecodeArgs()
+	dff_OutOpen()
 
 	Parameters
 		`d' is the info struct.
-		`argc' is the number of command-line arguments.
-		`argv' are the command line args.
+		`out' is the output to open.
+		`name' is the file name, or NULL for stdout.
+		`append' is non-zero to add to an existing file.
+		`zip' is non-zero to gzip it (-z).
 
 	Description
-		set the appropriate flags and values in `d' as
-		specified by the user.  call dff_Usage() if invalid
-		command line is encountered.
+		open a buffered output file.  stdout is written in
+		order, as it may be a pipe.  a gzip'd output is
+		written in order to its helper thread; one opened
+		again gets another gzip member, which gunzip reads
+		as part of the same file.
 
 	Calls
 		System
-			strlen(), fprintf(), atoi(), printf().
+			open(), lseek(), fflush(), fileno(), malloc(),
+			fprintf(), strerror().
 		Local
-			dff_Usage().
+			dff_ZipOpen(), dff_OutOfSpace(), dff_CleanUp().
 
 	Alters
 		Incoming
-			`d'.
+			`out'.
 
 	History
-		dw	15 dec 92
+		ag	16 oct 26
  +*/
-void	dff_DecodeArgs(d, argc, argv)
+void	dff_OutOpen(d, out, name, append, zip)
 DF_INFO	*d;
-int	argc;
-char	*argv[];
+DF_OUT	*out;
+char	*name;
+int	append,
+	zip;
 {
-	int	i;
-
-	if (argc < 2) dff_Usage();
-
-	/*
-		process the command line arguments.
-		they can come in any order and can be concatenated.
-	 */
-	for (i = 1 ; i < argc ; i++)
-		if (argv[i][0] == '-') {
-			int	opt_len, opt_indx = 0;
-			if (strlen(argv[i]) < 2) dff_Usage();
+	if (name == (char *)NULL) {
+		fflush(stdout);
+		out->fd = fileno(stdout);
+		out->seq = 1;
+	} else if ((out->fd = open(name, O_WRONLY | O_CREAT |
+		(append ? 0 : O_TRUNC), 0666)) < 0) {
+		/*
+			not always a full disk; too many open files, or
+			no permission.
+		 */
+		fprintf(stderr, "\n%s: cannot open `%s': %s\n", PROGNAME,
+			name, strerror(errno));
+		dff_CleanUp(d, DF_FAILURE);
+	}
+	out->offset = (append && !out->seq ?
+		(long)lseek(out->fd, 0L, 2) : 0L);
+	out->used = 0;
+	if ((out->buffer = (char *)malloc(DF_OUT_BUFSIZE)) == (char *)NULL)
+		dff_OutOfSpace(d);
+#ifdef	DF_HAVE_ZLIB
+	if (zip) {
+		DF_ZIP	*z;
+
+		if (append) (void)lseek(out->fd, 0L, 2);
+		if ((z = (DF_ZIP *)malloc(sizeof(DF_ZIP))) == (DF_ZIP *)NULL)
+			dff_OutOfSpace(d);
+		out->fd = dff_ZipOpen(d, z, out->fd, 1);
+		out->zip = z;
+		out->seq = 1;
+	}
+#else
+	(void)zip;
+#endif
+}
+
+/*+
+	dff_OutWrite()
+
+	Parameters
+		`d' is the info struct.
+		`out' is the output.
+		`ptr' holds `len' bytes to add to `out'.
+
+	Calls
+		System
+			memcpy().
+		Local
+			dff_IoWrite().
+
+	Alters
+		Incoming
+			`out'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dff_OutWrite(d, out, ptr, len)
+DF_INFO	*d;
+DF_OUT	*out;
+char	*ptr;
+int	len;
+{
+	while (len > 0) {
+		int	n = DF_OUT_BUFSIZE - out->used;
+
+		if (n > len) n = len;
+		memcpy(out->buffer + out->used, ptr, (size_t)n);
+		out->used += n;
+		ptr += n;
+		len -= n;
+		if (out->used == DF_OUT_BUFSIZE)
+			dff_IoWrite(d, out, DF_SUCCESS);
+	}
+}
+
+/*+
+	dff_OutClose()
+
+	Parameters
+		`d' is the info struct.
+		`out' is the output.
+		`status' is DF_SUCCESS or DF_FAILURE.
+
+	Description
+		write anything still buffered (unless `status' is
+		DF_FAILURE), wait for queued writes, and close `out'.
+		a -z output waits for its helper thread.
+
+	Calls
+		System
+			fsync(), close(), free().
+		Local
+			dff_IoWrite(), dff_IoWait(), dff_ZipEnd(),
+			dff_OutOfSpace().
+
+	Alters
+		Incoming
+			`out'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dff_OutClose(d, out, status)
+DF_INFO	*d;
+DF_OUT	*out;
+int	status;
+{
+	if (out->fd < 0) return;
+	if (status == DF_SUCCESS)
+		dff_IoWrite(d, out, status);
+	out->used = 0;
+	dff_IoWait(d, 1, status);
+#ifdef	DF_HAVE_MMAP
+	if (status == DF_SUCCESS && d->ckp_recs > 0L && fsync(out->fd) != 0)
+		/*
+			a part closed between -c checkpoints is on
+			disk when the next is written.
+		 */
+		dff_OutOfSpace(d);
+#endif
+	close(out->fd);
+	out->fd = -1;
+	if (out->buffer != (char *)NULL) free(out->buffer);
+	out->buffer = (char *)NULL;
+#ifdef	DF_HAVE_ZLIB
+	if (out->zip != (DF_ZIP *)NULL) {
+		/*
+			wait for the last of it to be compressed.
+		 */
+		int	failed = dff_ZipEnd(out->zip);
+
+		free((char *)out->zip);
+		out->zip = (DF_ZIP *)NULL;
+		if (failed && status == DF_SUCCESS)
+			dff_OutOfSpace(d);
+	}
+#endif
+}
+
+/*+
+	dff_AddrWrite()
+
+	Parameters
+		`d' is the info struct.
+		`ptr' holds `len' bytes of .dft lines.
+
+	Description
+		add to the .dfa addresses of the file in use.  they are
+		held in memory while `d->addr_limit' allows; the first
+		time it does not, the file's addresses move to its .dft
+		temp file and stay there.
+
+	Calls
+		System
+			memcpy(), realloc(), free().
+		Local
+			dff_GenDfilename(), dff_OutOpen(), dff_OutWrite(),
+			dff_OutOfSpace().
+
+	Alters
+		Incoming
+			`d->cur->addrs', `d->addr_held', `d->cur->dfa'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dff_AddrWrite(d, ptr, len)
+DF_INFO	*d;
+char	*ptr;
+int	len;
+{
+	DF_ADDRS	*a = &d->cur->addrs;
+
+	if (!a->spilled && a->used + len > a->size) {
+		long	size = (a->size > 0L ? a->size : (long)DF_ADDR_CHUNK);
+
+		while (size < a->used + len) size *= 2L;
+		if (d->addr_held - a->size + size <= d->addr_limit) {
+			char	*text = (char *)realloc(a->text, (size_t)size);
+
+			if (text == (char *)NULL) dff_OutOfSpace(d);
+			d->addr_held += size - a->size;
+			a->text = text;
+			a->size = size;
+		} else {
+			/*
+				too many held; start the .dft file.
+			 */
+			long	done;
+
+			dff_OutOpen(d, &d->cur->dfa,
+				dff_GenDfilename(d, DF_TMP_EXT), 0, 0);
+			for (done = 0L ; done < a->used ;
+				done += DF_OUT_BUFSIZE)
+				dff_OutWrite(d, &d->cur->dfa, a->text + done,
+					(int)(a->used - done > DF_OUT_BUFSIZE ?
+					DF_OUT_BUFSIZE : a->used - done));
+			if (a->text != (char *)NULL) free(a->text);
+			d->addr_held -= a->size;
+			a->text = (char *)NULL;
+			a->used = a->size = 0L;
+			a->spilled = 1;
+		}
+	}
+
+	if (a->spilled) {
+		if (d->cur->dfa.fd < 0)
+			dff_OutOpen(d, &d->cur->dfa,
+				dff_GenDfilename(d, DF_TMP_EXT), 1, 0);
+		dff_OutWrite(d, &d->cur->dfa, ptr, len);
+	} else {
+		memcpy(a->text + a->used, ptr, (size_t)len);
+		a->used += len;
+	}
+}
+
+/*+
+	dff_CopyFile()
+
+	Parameters
+		`d' is the info struct.
+		`to' is the file to add to.
+		`name' is the file to copy.
+
+	Description
+		append the file `name' to `to'.  copy_file_range() lets
+		the kernel do the copy where it can; read() and write()
+		do the rest.
+
+	Calls
+		System
+			fflush(), fileno(), open(), read(), write(), close(),
+			malloc(), free(), syscall().
+		Local
+			dff_OutOfSpace().
+
+	History
+		ag	16 oct 26
+ +*/
+void	dff_CopyFile(d, to, name)
+DF_INFO	*d;
+FILE	*to;
+char	*name;
+{
+	int	in,
+		out = fileno(to);
+	long	n;
+	char	*buffer;
+
+	if (fflush(to) != 0) dff_OutOfSpace(d);
+	if ((in = open(name, O_RDONLY)) < 0) dff_OutOfSpace(d);
+
+#if defined(DF_HAVE_COPY_RANGE) && defined(SYS_copy_file_range)
+	while ((n = (long)syscall(SYS_copy_file_range, in, (void *)NULL,
+		out, (void *)NULL, (size_t)(1024L * 1024L * 1024L), 0)) > 0L)
+		;
+	if (n == 0L) {
+		close(in);
+		return;
+	}
+	/*
+		not between these files; copy what is left the slow way.
+	 */
+#endif
+	if ((buffer = (char *)malloc(DF_OUT_BUFSIZE)) == (char *)NULL)
+		dff_OutOfSpace(d);
+	while ((n = (long)read(in, buffer, DF_OUT_BUFSIZE)) > 0L)
+		if ((long)write(out, buffer, (size_t)n) != n) {
+			free(buffer);
+			close(in);
+			dff_OutOfSpace(d);
+		}
+	free(buffer);
+	close(in);
+	if (n < 0L) dff_OutOfSpace(d);
+}
+
+/*+
+	dff_AddPart()
+
+	Parameters
+		`d' is the info struct.
+		`name' is the file name (less extension) of the part,
+		or NULL when not splitting.
+
+	Description
+		add an output Dfile database.
+
+	Calls
+		System
+			realloc(), malloc(), strcpy(), strlen().
+		Local
+			dff_OutOfSpace().
+
+	Alters
+		Incoming
+			`d->part', `d->num_parts'.
+
+	Return Values
+		Explicit
+			the part #.
+
+	History
+		ag	16 oct 26
+ +*/
+int	dff_AddPart(d, name)
+DF_INFO	*d;
+char	*name;
+{
+	DF_PART	*part;
+
+	if (d->num_parts == d->max_parts) {
+		int	max = (d->max_parts > 0 ? d->max_parts * 2 :
+				DF_MAX_SPLIT);
+
+		if ((part = (DF_PART *)realloc((char *)d->part,
+			sizeof(DF_PART) * max)) == (DF_PART *)NULL)
+			dff_OutOfSpace(d);
+		d->part = part;
+		d->max_parts = max;
+	}
+	part = &d->part[d->num_parts];
+	part->name = (char *)NULL;
+	if (name != (char *)NULL) {
+		if ((part->name = (char *)malloc(strlen(name) + 1)) ==
+			(char *)NULL)
+			dff_OutOfSpace(d);
+		strcpy(part->name, name);
+	}
+	part->dff.fd = part->dfa.fd = -1;
+	part->dff.buffer = part->dfa.buffer = (char *)NULL;
+	part->dff.used = part->dfa.used = 0;
+	part->dff.seq = part->dfa.seq = 0;
+#ifdef	DF_HAVE_ZLIB
+	part->dff.zip = part->dfa.zip = (DF_ZIP *)NULL;
+#endif
+	part->addrs.text = (char *)NULL;
+	part->addrs.used = part->addrs.size = 0L;
+	part->addrs.spilled = 0;
+	part->newer = part->older = -1;
+	part->physical = part->logical = part->kept = 0L;
+	part->next_value = -1L;
+	return d->num_parts++;
+}
+
+/*+
+	dff_FindPart()
+
+	Parameters
+		`d' is the info struct.
+		`name' is the file name (less extension) of a part.
+
+	Description
+		find the part named `name', adding it if there is
+		none yet.  parts are hashed by name.
+
+	Calls
+		System
+			malloc(), free(), strcmp().
+		Local
+			dff_AddPart(), dff_OutOfSpace().
+
+	Alters
+		Incoming
+			`d->part_hash', `d->hash_size'.
+
+	Return Values
+		Explicit
+			the part #.
+
+	History
+		ag	16 oct 26
+ +*/
+int	dff_FindPart(d, name)
+DF_INFO	*d;
+char	*name;
+{
+	unsigned long	h = 2166136261UL;
+	char		*p;
+	int		i;
+
+	for (p = name ; *p ; p++)
+		h = ((h ^ (unsigned long)(*p & 0xff)) * 16777619UL) &
+			0xffffffffUL;
+
+	if (d->num_parts * 2 >= d->hash_size) {
+		/*
+			keep the table at most half full.
+		 */
+		int	size = (d->hash_size > 0 ? d->hash_size * 2 : 64),
+			*hash = (int *)malloc(sizeof(int) * size);
+
+		if (hash == (int *)NULL) dff_OutOfSpace(d);
+		for (i = 0 ; i < size ; i++) hash[i] = -1;
+		for (i = 0 ; i < d->num_parts ; i++) {
+			unsigned long	g = 2166136261UL;
+			int		at;
+
+			for (p = d->part[i].name ; *p ; p++)
+				g = ((g ^ (unsigned long)(*p & 0xff)) *
+					16777619UL) & 0xffffffffUL;
+			for (at = (int)(g & (size - 1)) ; hash[at] >= 0 ;
+				at = (at + 1) & (size - 1))
+				;
+			hash[at] = i;
+		}
+		if (d->part_hash != (int *)NULL) free((char *)d->part_hash);
+		d->part_hash = hash;
+		d->hash_size = size;
+	}
+
+	for (i = (int)(h & (d->hash_size - 1)) ; d->part_hash[i] >= 0 ;
+		i = (i + 1) & (d->hash_size - 1))
+		if (strcmp(d->part[d->part_hash[i]].name, name) == 0)
+			return d->part_hash[i];
+	return d->part_hash[i] = dff_AddPart(d, name);
+}
+
+/*+
+	dff_InitParts()
+
+	Parameters
+		`d' is the info struct.
+
+	Description
+		add the output Dfile databases known before any record
+		is read: the only one when not splitting, a-z, "other"
+		and "numbers" when splitting by letter, and 0..N-1 when
+		splitting by -k hN.  -k pN and bN add theirs as they
+		are found.
+
+	Calls
+		System
+			sprintf().
+		Local
+			dff_AddPart().
+
+	Alters
+		Incoming
+			`d->part', `d->indx', `d->cur'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dff_InitParts(d)
+DF_INFO	*d;
+{
+	char	name[32];
+	int	i;
+
+	if (d->split == DF_NOT_SPLIT)
+		dff_AddPart(d, (char *)NULL);
+	else if (d->key_how == DF_KEY_LETTER) {
+		for (i = 0 ; i < DF_OTHER_FILE ; i++) {
+			sprintf(name, "%c", i + 'a');
+			dff_AddPart(d, name);
+		}
+		dff_AddPart(d, DF_OTHER_NAME);
+		dff_AddPart(d, DF_NUMBER_NAME);
+	} else if (d->key_how == DF_KEY_HASH) {
+		int	width = sprintf(name, "%d", d->key_arg - 1);
+
+		for (i = 0 ; i < d->key_arg ; i++) {
+			sprintf(name, "%0*d", width, i);
+			dff_AddPart(d, name);
+		}
+	}
+	d->indx = 0;
+	d->cur = (d->num_parts > 0 ? &d->part[0] : (DF_PART *)NULL);
+}
+
+/*+
+	dff_LinkPart()
+
+	Parameters
+		`d' is the info struct.
+		`indx' is the part #.
+
+	Description
+		make part `indx' the most recently used open part.
+
+	Alters
+		Incoming
+			`d->part', `d->newest', `d->oldest'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dff_LinkPart(d, indx)
+DF_INFO	*d;
+int	indx;
+{
+	DF_PART	*part = &d->part[indx];
+
+	part->newer = -1;
+	if ((part->older = d->newest) >= 0)
+		d->part[d->newest].newer = indx;
+	else
+		d->oldest = indx;
+	d->newest = indx;
+}
+
+/*+
+	dff_UnlinkPart()
+
+	Parameters
+		`d' is the info struct.
+		`indx' is the part #.
+
+	Description
+		take part `indx' out of the open parts.
+
+	Alters
+		Incoming
+			`d->part', `d->newest', `d->oldest'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dff_UnlinkPart(d, indx)
+DF_INFO	*d;
+int	indx;
+{
+	DF_PART	*part = &d->part[indx];
+
+	if (part->newer >= 0)
+		d->part[part->newer].older = part->older;
+	else
+		d->newest = part->older;
+	if (part->older >= 0)
+		d->part[part->older].newer = part->newer;
+	else
+		d->oldest = part->newer;
+	part->newer = part->older = -1;
+}
+
+/*+
+	dff_UsePart()
+
+	Parameters
+		`d' is the info struct.
+		`indx' is the part #.
+
+	Description
+		write to part `indx' from now on.
+
+	Calls
+		Local
+			dff_UnlinkPart(), dff_LinkPart().
+
+	Alters
+		Incoming
+			`d->indx', `d->cur'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dff_UsePart(d, indx)
+DF_INFO	*d;
+int	indx;
+{
+	d->cur = &d->part[d->indx = indx];
+	if (d->cur->dff.fd >= 0 && d->newest != indx) {
+		dff_UnlinkPart(d, indx);
+		dff_LinkPart(d, indx);
+	}
+}
+
+/*+
+	dff_ClosePart()
+
+	Parameters
+		`d' is the info struct.
+		`indx' is the part #.
+		`status' is DF_SUCCESS or DF_FAILURE.
+
+	Description
+		close the files of part `indx', if open.  it is opened
+		again by dff_Open() if more is written to it.
+
+	Calls
+		Local
+			dff_OutClose(), dff_UnlinkPart().
+
+	Alters
+		Incoming
+			`d->part', `d->num_open'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dff_ClosePart(d, indx, status)
+DF_INFO	*d;
+int	indx,
+	status;
+{
+	DF_PART	*part = &d->part[indx];
+
+	/*
+		the .dft can be open without the .dff, when an -i
+		run reloads its addresses and converts nothing.
+	 */
+	dff_OutClose(d, &part->dfa, status);
+	if (part->dff.fd < 0) return;
+	dff_OutClose(d, &part->dff, status);
+	dff_UnlinkPart(d, indx);
+	d->num_open--;
+}
+
+/*+
+	dff_MaxOpen()
+
+	Parameters
+		`d' is the info struct.
+
+	Description
+		set how many split databases may be open at once: up to
+		DF_MAX_OPEN, as many as the descriptor limit allows.
+		each open part takes its .dff and .dft, and with -z a
+		helper's pipe and file as well.  DF_FD_RESERVE are
+		kept for the dBase files, .dfa, io_uring and the like;
+		-M opens all of its dBase files.
+
+	Calls
+		System
+			getrlimit().
+
+	Alters
+		Incoming
+			`d->max_open'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dff_MaxOpen(d)
+DF_INFO	*d;
+{
+#ifdef	DF_HAVE_RLIMIT
+	struct rlimit	rl;
+	long	per = (FLAG_SET(d->flags.zip) ? 4L : 2L),
+		reserve = DF_FD_RESERVE,
+		n;
+
+	if (FLAG_SET(d->flags.merge))
+		reserve += 3L * d->num_batch;
+	d->max_open = DF_MAX_OPEN;
+	if (getrlimit(RLIMIT_NOFILE, &rl) != 0 || rl.rlim_cur == RLIM_INFINITY ||
+		rl.rlim_cur >= (rlim_t)(reserve + (per * DF_MAX_OPEN)))
+		return;
+	n = ((long)rl.rlim_cur - reserve) / per;
+	d->max_open = (n < 1L ? 1 : (int)n);
+#else
+	d->max_open = DF_MAX_OPEN;
+#endif
+}
+
+/*+
+	dff_Open()
+
+	Parameters
+		`d' is the info struct.
+
+	Description
+		open the .dff file specified by `d->indx', closing
+		another if `d->max_open' are already open.  a file opened
+		again is added to.  with -o -, the .dff is stdout.
+		Dfile record starting block information is kept by
+		dff_AddrWrite() and written to .dfa files by
+		dff_DFTtoDFA() upon successful conversion of the entire
+		dBase file.
+
+	Calls
+		System
+			sprintf().
+		Local
+			dff_OutOpen(), dff_OutWrite(), dff_ClosePart(),
+			dff_LinkPart().
+
+	Alters
+		Incoming
+			`d->cur->dff', `d->num_open'.
+
+	History
+		dw	15 dec 92
+ +*/
+void	dff_Open(d)
+DF_INFO	*d;
+{
+	if (d->num_open >= d->max_open)
+		/*
+			make room; close the least recently used.
+		 */
+		dff_ClosePart(d, d->oldest, DF_SUCCESS);
+	dff_OutOpen(d, &d->cur->dff, (FLAG_SET(d->flags.dff_pipe) ?
+		(char *)NULL : dff_GenDfilename(d, DF_DF_EXT)),
+		(d->cur->logical > 0L), FLAG_SET(d->flags.zip));
+	dff_LinkPart(d, d->indx);
+	d->num_open++;
+
+	if (d->cur->logical == 0L) {
+		/*
+			this is the first time this file has been opened;
+			output the FreeList information.
+			NOTE: the created .dff file must have the same
+			Model name as the .dfh file.
+		 */
+		char	line[DF_BLOCK_LEN + 100];
+
+		dff_OutWrite(d, &d->cur->dff, line,
+			sprintf(line, "Version={%s} Model={%.*s}%*d\n",
+			DF_VERSION_STRING, DF_BLOCK_LEN, d->model,
+			(int)(DF_REC_WIDTH - (26 + strlen(d->model))) +
+			DF_ADDR_WIDTH, DF_FREELIST));
+	}
+}
+
+/*+
+	dff_FormatLong()
+
+	Parameters
+		`dst' receives the digits.
+		`value' is the number to format.
+
+	Description
+		format `value' as "%ld" would, without the printf()
+		machinery.
+
+	Calls
+		System
+			memcpy().
+
+	Return Values
+		Explicit
+			the number of chars put in `dst'.
+
+	History
+		ag	16 oct 26
+ +*/
+int	dff_FormatLong(dst, value)
+char	*dst;
+long	value;
+{
+	char		tmp[24],
+			*p = tmp + sizeof(tmp);
+	unsigned long	u = (value < 0L) ? -(unsigned long)value :
+				(unsigned long)value;
+	int		n;
+
+	do {
+		*--p = (char)('0' + (u % 10));
+		u /= 10;
+	} while (u != 0);
+	if (value < 0L) *--p = '-';
+	n = (int)(tmp + sizeof(tmp) - p);
+	memcpy(dst, p, (size_t)n);
+	return n;
+}
+
+/*+
+	dff_FormatAddr()
+
+	Parameters
+		`dst' receives DF_ADDR_WIDTH chars.
+		`value' is the block address.
+
+	Description
+		format `value' as "%*ld" would with a width of
+		DF_ADDR_WIDTH.
+
+	Calls
+		System
+			memset().
+		Local
+			dff_FormatLong().
+
+	Return Values
+		Explicit
+			0 if `value' needs more than DF_ADDR_WIDTH chars
+			(`dst' is then left alone), otherwise 1.
+
+	History
+		ag	16 oct 26
+ +*/
+int	dff_FormatAddr(dst, value)
+char	*dst;
+long	value;
+{
+	char	tmp[24];
+	int	n = dff_FormatLong(tmp, value);
+
+	if (n > DF_ADDR_WIDTH) return 0;
+	memset(dst, ' ', (size_t)(DF_ADDR_WIDTH - n));
+	memcpy(dst + DF_ADDR_WIDTH - n, tmp, (size_t)n);
+	return 1;
+}
+
+/*+
+	dff_NextAddr()
+
+	Parameters
+		`d' is the info struct.
+		`value' is the next block address.
+
+	Description
+		get the text of a next block address.  addresses
+		normally climb by one, so the last one is kept as text
+		and counted up in place.
+
+	Calls
+		Local
+			dff_FormatAddr().
+
+	Alters
+		Incoming
+			`d->cur->next_addr', `d->cur->next_value'.
+
+	Return Values
+		Explicit
+			DF_ADDR_WIDTH chars, or NULL if `value' does not
+			fit in them.
+
+	History
+		ag	16 oct 26
+ +*/
+char	*dff_NextAddr(d, value)
+DF_INFO	*d;
+long	value;
+{
+	if (d->cur->next_value >= 0L && value == d->cur->next_value + 1L) {
+		char	*p = d->cur->next_addr + DF_ADDR_WIDTH;
+
+		while (--p >= d->cur->next_addr) {
+			if (*p == '9') {
+				*p = '0';
+				continue;
+			}
+			*p = (*p == ' ') ? '1' : (char)(*p + 1);
+			d->cur->next_value = value;
+			return d->cur->next_addr;
+		}
+	} else if (dff_FormatAddr(d->cur->next_addr, value)) {
+		d->cur->next_value = value;
+		return d->cur->next_addr;
+	}
+	d->cur->next_value = -1L;
+	return (char *)NULL;
+}
+
+/*+
+	dff_OutBlock()
+
+	Parameters
+		`d' is the info struct.
+		`ptr' holds `len' bytes of block text.
+		`addr' holds the DF_ADDR_WIDTH chars of the next block
+		address.
+
+	Description
+		format a .dff block straight into the .dff output
+		buffer, padding the text with blanks.
+
+	Calls
+		System
+			memcpy(), memset().
+		Local
+			dff_IoWrite().
+
+	Alters
+		Incoming
+			`d->cur->dff'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dff_OutBlock(d, ptr, len, addr)
+DF_INFO	*d;
+char	*ptr;
+int	len;
+char	*addr;
+{
+	DF_OUT	*out = &d->cur->dff;
+	char	*dst;
+
+	if (out->used > DF_OUT_BUFSIZE - DF_BLOCK_LEN)
+		dff_IoWrite(d, out, DF_SUCCESS);
+	dst = out->buffer + out->used;
+	memcpy(dst, ptr, (size_t)len);
+	memset(dst + len, ' ', (size_t)(DF_REC_WIDTH - len));
+	memcpy(dst + DF_REC_WIDTH, addr, (size_t)DF_ADDR_WIDTH);
+	dst[DF_BLOCK_LEN - 1] = '\n';
+	out->used += DF_BLOCK_LEN;
+}
+
+/*+
+	dff_FullBlock()
+
+	Parameters
+		`d' is the info struct.
+		`ptr' holds DF_REC_WIDTH bytes of block text.
+
+	Description
+		write a full block that more text follows.
+
+	Calls
+		System
+			sprintf().
+		Local
+			dff_NextAddr(), dff_OutBlock(), dff_OutWrite().
+
+	Alters
+		Incoming
+			`d->cur->physical'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dff_FullBlock(d, ptr)
+DF_INFO	*d;
+char	*ptr;
+{
+	long	next = ++(d->cur->physical) + 1L;
+	char	*addr = dff_NextAddr(d, next);
+
+	if (addr != (char *)NULL)
+		dff_OutBlock(d, ptr, DF_REC_WIDTH, addr);
+	else {
+		/*
+			the address outgrew its column.
+		 */
+		char	line[DF_BLOCK_LEN + 32];
+
+		dff_OutWrite(d, &d->cur->dff, line, sprintf(line,
+			"%.*s%*ld\n", DF_REC_WIDTH, ptr, DF_ADDR_WIDTH, next));
+	}
+}
+
+/*+
+	dff_PutBlocks()
+
+	Parameters
+		`d' is the info struct.
+		`ptr' holds `len' more bytes of the Dfile record.
+
+	Description
+		add text to the Dfile record being written.
+		a block is written as soon as it is full and more text
+		follows it, so records of any length are written in
+		constant space.  dff_EndBlocks() writes the last block.
+		full blocks are taken straight from `ptr' when nothing
+		is held in `d->block'.
+
+	Calls
+		System
+			memcpy().
+		Local
+			dff_FullBlock().
+
+	Alters
+		Incoming
+			`d->block', `d->cur->physical'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dff_PutBlocks(d, ptr, len)
+DF_INFO	*d;
+char	*ptr;
+int	len;
+{
+	while (len > 0) {
+		int	n;
+
+		if (d->block_used == DF_REC_WIDTH) {
+			/*
+				more text follows a full block.
+			 */
+			dff_FullBlock(d, d->block);
+			d->block_used = 0;
+		}
+		if (d->block_used == 0)
+			for ( ; len > DF_REC_WIDTH ; ptr += DF_REC_WIDTH,
+				len -= DF_REC_WIDTH)
+				dff_FullBlock(d, ptr);
+		if ((n = DF_REC_WIDTH - d->block_used) > len) n = len;
+		memcpy(d->block + d->block_used, ptr, (size_t)n);
+		d->block_used += n;
+		ptr += n;
+		len -= n;
+	}
+}
+
+/*+
+	dff_EndBlocks()
+
+	Parameters
+		`d' is the info struct.
+
+	Description
+		write the last block of the Dfile record.
+
+	Calls
+		Local
+			dff_FormatAddr(), dff_OutBlock().
+
+	Alters
+		Incoming
+			`d->block', `d->cur->physical'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dff_EndBlocks(d)
+DF_INFO	*d;
+{
+	char	addr[DF_ADDR_WIDTH];
+
+	(void)dff_FormatAddr(addr, (long)DF_REC_END);
+	dff_OutBlock(d, d->block, d->block_used, addr);
+	d->block_used = 0;
+	++(d->cur->physical);
+}
+
+/*+
+	dff_WriteAddr()
+
+	Parameters
+		`d' is the info struct.
+
+	Description
+		count a new Dfile record starting at the next block,
+		and add its .dfa address.
+
+	Calls
+		Local
+			dff_FormatLong(), dff_AddrWrite().
+
+	Alters
+		Incoming
+			`d->cur->logical'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dff_WriteAddr(d)
+DF_INFO	*d;
+{
+	char	line[64],
+		*p = line;
+
+	*p++ = (FLAG_SET(d->flags.protect_recs) ? '-' : ' ');
+	p += dff_FormatLong(p, ++(d->cur->logical));
+	*p++ = '\t';
+	p += dff_FormatLong(p, d->cur->physical + 1L);
+	*p++ = '\n';
+	dff_AddrWrite(d, line, (int)(p - line));
+}
+
+/*+
+	dff_WriteBlocks()
+
+	Parameters
+		`d' is the info struct.
+		`ptr' holds an already-Dfile-formatted string.
+		`len' is the length of the string.
+		`which' is either DF_WRITING_RECORD or DF_WRITING_MEMO.
+
+	Description
+		writes the field-delimited string in the Dfile format
+		to the .dff file and bumps the block pointer by the
+		number of blocks written.
+
+	Calls
+		Local
+			dff_TrimSpan(), dff_Open(), dff_WriteAddr(),
+			dff_PutBlocks(), dff_EndBlocks().
+
+	Alters
+		Incoming
+			`d->cur->dff', `d->cur->physical'.
+
+	Return Values
+		Explicit
+			returns exit code to the OS.
+
+	History
+		dw	15 dec 92
+ +*/
+void	dff_WriteBlocks(d, ptr, len, which)
+DF_INFO	*d;
+char	*ptr;
+int	len,
+	which;
+{
+	if (d->cur->dff.fd < 0)
+		/*
+			open the output files if not already open.
+		 */
+		dff_Open(d);
+
+	if (which == DF_WRITING_RECORD)
+		/*
+			add the starting record block to the .dfa
+			addresses.
+		 */
+		dff_WriteAddr(d);
+	else
+		/*
+			remove special dBase chars and get into smallest space.
+		 */
+		len = dff_TrimSpan(ptr, len, ptr);
+
+	/*
+		split the formatted string into Dfile blocks.
+	 */
+	dff_PutBlocks(d, ptr, len);
+	dff_EndBlocks(d);
+}
+
+/*+
+	dff_BlockBytes()
+
+	Parameters
+		`first' is the number of the first of `blocks' .dff
+		blocks of a record.
+
+	Description
+		find how many bytes the blocks take.  a block is
+		DF_BLOCK_LEN bytes unless its next block address
+		outgrew its DF_ADDR_WIDTH column.
+
+	Return Values
+		Explicit
+			returns the bytes in the blocks.
+
+	History
+		ag	16 oct 26
+ +*/
+long	dff_BlockBytes(first, blocks)
+long	first,
+	blocks;
+{
+	long	bytes = blocks * DF_BLOCK_LEN,
+		last = first + blocks - 1L,	/* the last address written */
+		wide = 100000000L;		/* 10 ^ DF_ADDR_WIDTH */
+
+	while (wide <= last) {
+		/*
+			one more byte for each address at or past `wide'.
+		 */
+		bytes += last - (wide > first + 1L ? wide : first + 1L) + 1L;
+		if (wide > last / 10L) break;
+		wide *= 10L;
+	}
+	return bytes;
+}
+
+/*+
+	dff_FormatBlocks()
+
+	Parameters
+		`dst' receives the blocks.
+		`ptr' holds `len' bytes of Dfile record (or memo) text.
+		`first' is the number of its first .dff block.
+
+	Description
+		format text into .dff blocks just as dff_PutBlocks()
+		and dff_EndBlocks() write them, for blocks numbered
+		ahead of time.
+
+	Calls
+		System
+			memcpy(), memset(), sprintf().
+		Local
+			dff_FormatAddr().
+
+	Return Values
+		Explicit
+			returns the bytes put in `dst'; dff_BlockBytes().
+
+	History
+		ag	16 oct 26
+ +*/
+long	dff_FormatBlocks(dst, ptr, len, first)
+char	*dst,
+	*ptr;
+long	len,
+	first;
+{
+	char	*out = dst;
+
+	for ( ; len > DF_REC_WIDTH ; ptr += DF_REC_WIDTH, len -= DF_REC_WIDTH) {
+		/*
+			a full block that more text follows.
+		 */
+		memcpy(out, ptr, (size_t)DF_REC_WIDTH);
+		if (dff_FormatAddr(out + DF_REC_WIDTH, ++first)) {
+			out[DF_BLOCK_LEN - 1] = '\n';
+			out += DF_BLOCK_LEN;
+		} else
+			out += DF_REC_WIDTH + sprintf(out + DF_REC_WIDTH,
+				"%*ld\n", DF_ADDR_WIDTH, first);
+	}
+	memcpy(out, ptr, (size_t)len);
+	memset(out + len, ' ', (size_t)(DF_REC_WIDTH - len));
+	(void)dff_FormatAddr(out + DF_REC_WIDTH, (long)DF_REC_END);
+	out[DF_BLOCK_LEN - 1] = '\n';
+	return (out + DF_BLOCK_LEN) - dst;
+}
+
+/*+
+	dff_Progress()
+
+	Parameters
+		`d' is the info struct.
+		`rec' is the dBase record just converted.
+
+	Description
+		show percent done, every `d->report' records.
+
+	Calls
+		System
+			printf(), fflush().
+
+	Alters
+		Incoming
+			`d->percent_done'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dff_Progress(d, rec)
+DF_INFO	*d;
+long	rec;
+{
+	if (FLAG_NOT_SET(d->flags.terse) && (rec % d->report) == 0) {
+		printf("%d%% converted\n", d->percent_done++);
+		fflush(stdout);
+	}
+}
+
+/*+
+	dff_StripString()
+
+	Parameters
+		`str' points to the string to strip.
+		`len' is the length of the string.
+
+	Description
+		removes leading and trailing spaces from `ptr'.
+
+	Alters
+		Incoming
+			`ptr'.
+
+	Return Values
+		Explicit
+			length of stripped `ptr'.
+
+	History
+		dw	15 dec 92
+ +*/
+int	dff_StripString(str, len)
+char	**str;
+int	len;
+{
+	/*
+		remove leading and trailing whitespace.
+	 */
+	while (len > 0 && ((*str)[len - 1] == ' ' ||
+		(*str)[len - 1] == DF_DELIM)) (*str)[--len] = '\0';
+	while ((*str)[0] == ' ') (*str)++;
+
+	return len;
+}
+
+/*+
+	dff_TrimInit()
+
+	Description
+		fill in `trim_xlat', the byte each dBase byte becomes
+		in trimmed text: line ends become DF_DELIM, other
+		non-printing and non-ASCII bytes become spaces, and the
+		bytes that end dBase text (NUL, DBASE_MEMO_END) are 0.
+
+	Alters
+		Global
+			`trim_xlat'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dff_TrimInit()
+{
+	int	c;
+
+	for (c = 0 ; c < 256 ; c++)
+		trim_xlat[c] = (char)((c > ' ' && c < 0x7f) ? c : ' ');
+	trim_xlat[DBASE_LINE_FEED] = trim_xlat[DBASE_CARRIAGE] = DF_DELIM;
+	trim_xlat['\0'] = trim_xlat[DBASE_MEMO_END] = '\0';
+}
+
+/*+
+	dff_TrimSpan()
+
+	Parameters
+		`src' holds `len' bytes of dBase text.
+		`dst' receives the trimmed text; it must have room for
+			`len' + 1 bytes, and may be `src' itself.
+
+	Description
+		removes non-ASCII characters from dBase text,
+		removes multiple spaces and line feeds from the text
+		in preparation for use by dff_WriteBlocks().
+		one pass over the text, with each byte looked up in
+		`trim_xlat'; whole vectors of plain text or of spaces
+		are handled at once with SSE2/AVX2 when available.
+		the text ends at a NUL, or at a DBASE_MEMO_END; the
+		byte in front of the DBASE_MEMO_END is kept as it is
+		unless trailing blanks were removed.
+
+	Calls
+		System
+			_mm_*(), _mm256_*().
+
+	Return Values
+		Explicit
+			returns the length of the NUL-terminated `dst'.
+
+	History
+		ag	16 oct 26
+ +*/
+int	dff_TrimSpan(src, len, dst)
+char	*src;
+int	len;
+char	*dst;
+{
+	char	*out = dst;
+	int	i = 0,
+		run = 0,		/* last of a run of blanks (or 0) */
+		lead = 1,		/* still dropping leading spaces */
+		end = 0;
+
+	while (!end && i < len) {
+		int	stop = len;
+
+#if defined(DF_HAVE_AVX2) || defined(DF_HAVE_SSE2)
+#	ifdef	DF_HAVE_AVX2
+#		define	DF_VEC_LEN	32
+		__m256i	v;
+		int	plain = 0, blank = 0;
+
+		if (i + DF_VEC_LEN <= len) {
+			v = _mm256_loadu_si256((__m256i *)(src + i));
+			plain = (_mm256_movemask_epi8(_mm256_andnot_si256(
+				_mm256_cmpeq_epi8(v, _mm256_set1_epi8(DF_DELIM)),
+				_mm256_and_si256(
+				_mm256_cmpgt_epi8(v, _mm256_set1_epi8(' ')),
+				_mm256_cmpgt_epi8(_mm256_set1_epi8(0x7f), v)))) == -1);
+			blank = (_mm256_movemask_epi8(
+				_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '))) == -1);
+		}
+#	else
+#		define	DF_VEC_LEN	16
+		__m128i	v;
+		int	plain = 0, blank = 0;
+
+		if (i + DF_VEC_LEN <= len) {
+			v = _mm_loadu_si128((__m128i *)(src + i));
+			plain = (_mm_movemask_epi8(_mm_andnot_si128(
+				_mm_cmpeq_epi8(v, _mm_set1_epi8(DF_DELIM)),
+				_mm_and_si128(
+				_mm_cmpgt_epi8(v, _mm_set1_epi8(' ')),
+				_mm_cmplt_epi8(v, _mm_set1_epi8(0x7f))))) == 0xffff);
+			blank = (_mm_movemask_epi8(
+				_mm_cmpeq_epi8(v, _mm_set1_epi8(' '))) == 0xffff);
+		}
+#	endif
+		if (i + DF_VEC_LEN <= len) {
+			if ((plain || blank) && (i + DF_VEC_LEN == len ||
+				src[i + DF_VEC_LEN] != DBASE_MEMO_END)) {
+				/*
+					nothing in the vector ends the text.
+				 */
+				if (blank) {
+					if (!lead) run = ' ';
+				} else {
+					if (run != 0) *out++ = (char)run;
+					run = lead = 0;
+#	ifdef	DF_HAVE_AVX2
+					_mm256_storeu_si256((__m256i *)out, v);
+#	else
+					_mm_storeu_si128((__m128i *)out, v);
+#	endif
+					out += DF_VEC_LEN;
+				}
+				i += DF_VEC_LEN;
+				continue;
+			}
+			/*
+				byte at a time through this vector.
+			 */
+			stop = i + DF_VEC_LEN;
+		}
+#	undef	DF_VEC_LEN
+#endif
+		for ( ; i < stop ; i++) {
+			int	c = trim_xlat[src[i] & 0xff];
+
+			if (c == '\0' || (i + 1 < len &&
+				src[i + 1] == DBASE_MEMO_END)) {
+				end = 1;
+				break;
+			}
+			if (c == ' ' || c == DF_DELIM) {
+				if (lead && c == ' ') continue;
+				lead = 0;
+				run = c;
+			} else {
+				if (run != 0) *out++ = (char)run;
+				run = lead = 0;
+				*out++ = (char)c;
+			}
+		}
+	}
+
+	if (i < len && src[i] != '\0' &&
+		(i == 0 ? src[i] != ' ' : (!lead && run == 0)))
+		/*
+			keep the byte in front of the DBASE_MEMO_END
+			(or the DBASE_MEMO_END of an empty memo).
+		 */
+		*out++ = src[i];
+	*out = '\0';
+	return out - dst;
+}
+
+/*+
+	dff_TrimText()
+
+	Parameters
+		`ptr' is the Dfile string to trim.
+
+	Description
+		trims the NUL-terminated string `ptr' in place with
+		dff_TrimSpan().
+
+	Calls
+		System
+			strlen().
+		Local
+			dff_TrimSpan().
+
+	Alters
+		Incoming
+			`ptr'.
+
+	History
+		dw	15 dec 92
+		ag	16 oct 26
+ +*/
+void	dff_TrimText(ptr)
+char	**ptr;
+{
+	dff_TrimSpan(*ptr, strlen(*ptr), *ptr);
+}
+
+/*+
+	dff_TrimBegin()
+
+	Parameters
+		`t' is the trim state of a memo.
+		`exact' is non-zero when the length of the memo is
+			known, so that it has no end marker.
+
+	Description
+		get ready to trim a new memo with dff_TrimChunk().
+
+	Alters
+		Incoming
+			`t'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dff_TrimBegin(t, exact)
+DF_TRIM	*t;
+int	exact;
+{
+	t->exact = exact;
+	t->cur = -1;
+	t->run = 0;
+	t->lead = 1;
+	t->blank = t->done = 0;
+}
+
+/*+
+	dff_TrimChunk()
+
+	Parameters
+		`t' is the trim state of the memo.
+		`src' holds the next `len' bytes of the memo.
+		`dst' receives the trimmed text; it must have room
+			for `len' + 2 bytes: each byte of `src' gives
+			at most one, and the byte held back from the
+			last chunk and a run of blanks before it one
+			more each.
+
+	Description
+		the streaming form of dff_TrimText(), for memos too
+		long to hold in memory.  the memo is fed through in
+		chunks and comes out exactly as dff_TrimText() would
+		have left it: line ends become DF_DELIM, other
+		non-printing bytes become spaces, leading spaces and
+		trailing blanks are removed, and each run of spaces and
+		DF_DELIMs is reduced to its last character.
+		unless `t->exact' is set, the text ends at a NUL, or at
+		a DBASE_MEMO_END; the byte in front of the
+		DBASE_MEMO_END is kept as it is.
+		`t->done' is set once the end has been seen.
+
+	Alters
+		Incoming
+			`t'.
+
+	Return Values
+		Explicit
+			returns the number of bytes put in `dst'.
+
+	History
+		ag	16 oct 26
+ +*/
+int	dff_TrimChunk(t, src, len, dst)
+DF_TRIM	*t;
+char	*src;
+int	len;
+char	*dst;
+{
+	char	*out = dst;
+
+	while (len-- > 0 && !t->done) {
+		int	c = *src++ & 0xff;
+
+		if (!t->exact) {
+			/*
+				hold each byte back until the next one
+				shows whether the memo ends there.
+			 */
+			int	next = c;
+
+			if (next == DBASE_MEMO_END) {
+				/*
+					the byte before the end marker is
+					kept as-is unless trailing blanks
+					are being removed; an empty memo
+					keeps the end marker itself.
+				 */
+				if (t->cur < 0)
+					*out++ = (char)next;
+				else if (!t->blank && !(t->lead && t->cur == ' '))
+					*out++ = (char)t->cur;
+				t->done = 1;
+				break;
+			}
+			c = t->cur;
+			if ((t->cur = next) == '\0') t->done = 1;
+			if (c < 0) continue;
+		}
+
+		if ((c = trim_xlat[c]) == '\0')
+			/*
+				an exact memo holds NULs and end markers
+				like any other non-printing byte.
+			 */
+			c = ' ';
+
+		if (t->lead && c == ' ')
+			t->blank = 1;
+		else if (c == ' ' || c == DF_DELIM) {
+			t->lead = 0;
+			t->run = c;
+			t->blank = 1;
+		} else {
+			t->lead = t->blank = 0;
+			if (t->run != 0) *out++ = (char)t->run;
+			t->run = 0;
+			*out++ = (char)c;
+		}
+	}
+	return out - dst;
+}
+
+/*+
+	dff_TrimEnd()
+
+	Parameters
+		`t' is the trim state of the memo.
+		`dst' receives the end of the trimmed text; it must
+			have room for 2 bytes.
+
+	Description
+		finish a memo whose text ran out (the end of the file,
+		or the known length) without an end marker.
+
+	Calls
+		Local
+			dff_TrimChunk().
+
+	Return Values
+		Explicit
+			returns the number of bytes put in `dst'.
+
+	History
+		ag	16 oct 26
+ +*/
+int	dff_TrimEnd(t, dst)
+DF_TRIM	*t;
+char	*dst;
+{
+	char	nul = '\0';
+
+	if (t->exact) {
+		/*
+			trailing blanks are never written.
+		 */
+		t->done = 1;
+		return 0;
+	}
+	return dff_TrimChunk(t, &nul, 1, dst);
+}
+
+/*+
+	dBase_MapFile()
+
+	Parameters
+		`fp' is an open dBase file.
+		`len' receives the number of bytes mapped.
+
+	Description
+		map the whole of `fp' read-only into memory so that
+		dBase records and memos can be decoded straight out
+		of the page cache instead of being copied by fread().
+		the mapping is advised for sequential access.
+
+	Calls
+		System
+			fstat(), mmap(), madvise(), fileno().
+
+	Return Values
+		Explicit
+			returns the mapped file, or NULL if the file
+			cannot be mapped (not a regular file, too large
+			for the address space, or no mmap() on this system);
+			the caller falls back to stdio in that case.
+
+	History
+		ag	16 oct 26
+ +*/
+char	*dBase_MapFile(fp, len)
+FILE	*fp;
+long	*len;
+{
+	*len = 0L;
+#ifdef	DF_HAVE_MMAP
+	{
+		struct stat	st;
+		char		*map;
+
+		if (fstat(fileno(fp), &st) != 0 || !S_ISREG(st.st_mode) ||
+			st.st_size <= 0 || (off_t)(long)st.st_size != st.st_size)
+			return (char *)NULL;
+		if ((map = (char *)mmap((void *)NULL, (size_t)st.st_size,
+			PROT_READ, MAP_SHARED, fileno(fp), (off_t)0)) ==
+			(char *)MAP_FAILED)
+			return (char *)NULL;
+#	ifdef	MADV_SEQUENTIAL
+		madvise((void *)map, (size_t)st.st_size, MADV_SEQUENTIAL);
+#	endif
+		*len = (long)st.st_size;
+		return map;
+	}
+#else
+	return (char *)NULL;
+#endif
+}
+
+/*+
+	dBase_UnmapFile()
+
+	Parameters
+		`map' is a file mapped by dBase_MapFile() (or NULL).
+		`len' is the number of bytes mapped.
+
+	Calls
+		System
+			munmap().
+
+	History
+		ag	16 oct 26
+ +*/
+void	dBase_UnmapFile(map, len)
+char	*map;
+long	len;
+{
+#ifdef	DF_HAVE_MMAP
+	if (map != (char *)NULL) munmap((void *)map, (size_t)len);
+#endif
+}
+
+/*+
+	dBase_GetRecord()
+
+	Parameters
+		`d' is the info struct.
+
+	Description
+		locate dBase record `d->rec_num'.
+		when the .dbf is mapped, the record is used in place and
+		the pages of the next DF_MAP_WINDOW bytes are requested
+		ahead of time.  otherwise the record is read into
+		`d->rec_buffer' from the current position of `d->dbf'.
+
+	Calls
+		System
+			fread(), fprintf(), madvise().
+		Local
+			dff_CleanUp().
+
+	Return Values
+		Explicit
+			returns a pointer to the raw (unterminated) record.
+
+	History
+		ag	16 oct 26
+ +*/
+char	*dBase_GetRecord(d)
+DF_INFO	*d;
+{
+	long	rec_start = d->data_offset + (d->rec_num * (long)d->bytes);
+
+	if (d->dbf_map != (char *)NULL) {
+		if (rec_start + (long)d->bytes > d->dbf_map_len) {
+			fprintf(stderr, "\n%s: record %ld not %d bytes (%ld)!\n",
+				PROGNAME, d->rec_num, d->bytes,
+				(rec_start < d->dbf_map_len ?
+				d->dbf_map_len - rec_start : 0L));
+			dff_CleanUp(d, DF_FAILURE);
+		}
+#if defined(DF_HAVE_MMAP) && defined(MADV_WILLNEED)
+		if (rec_start + (long)d->bytes > d->advised) {
+			/*
+				ask for the next window of records before
+				they are needed.
+			 */
+			long	page = (long)getpagesize(),
+				start = rec_start - (rec_start % page),
+				len = DF_MAP_WINDOW;
+
+			if (start + len > d->dbf_map_len)
+				len = d->dbf_map_len - start;
+			madvise((void *)(d->dbf_map + start), (size_t)len,
+				MADV_WILLNEED);
+			d->advised = start + len;
+		}
+#endif
+		return d->dbf_map + rec_start;
+	}
+
+	{
+		int	bytes_read = fread(d->rec_buffer, 1, d->bytes, d->dbf);
+		if (bytes_read != d->bytes) {
+			fprintf(stderr, "\n%s: record %ld not %d bytes (%d)!\n",
+				PROGNAME, d->rec_num, d->bytes, bytes_read);
+			dff_CleanUp(d, DF_FAILURE);
+		}
+	}
+	return d->rec_buffer;
+}
+
+/*+
+	dBase_ReadAt()
+
+	Parameters
+		`fp' is an open dBase file.
+		`buf' receives up to `len' bytes read from offset `off'.
+
+	Description
+		positioned read that leaves the stdio position of
+		`fp' alone where the system has pread().
+
+	Calls
+		System
+			pread(), fseek(), fread(), fileno().
+
+	Return Values
+		Explicit
+			returns the number of bytes read, or -1.
+
+	History
+		ag	16 oct 26
+ +*/
+int	dBase_ReadAt(fp, buf, len, off)
+FILE	*fp;
+char	*buf;
+long	len,
+	off;
+{
+	int	total = 0;
+#ifdef	DF_HAVE_PWRITE
+	while (len > 0L) {
+		int	n = (int)pread(fileno(fp), buf, (size_t)len, (off_t)off);
+		if (n < 0) return -1;
+		if (n == 0) break;
+		buf += n; off += n; len -= n; total += n;
+	}
+#else
+	if (fseek(fp, off, 0) != 0) return -1;
+	total = (int)fread(buf, 1, (int)len, fp);
+#endif
+	return total;
+}
+
+/*+
+	dBase_CacheSlot()
+
+	Parameters
+		`c' is the .dbt block cache.
+		`block' is the .dbt block number.
+		`add' is non-zero to make room for `block' if it is
+			not already cached.
+
+	Description
+		look `block' up in the cache and make it the most
+		recently used.  a block being added takes over the
+		least recently used slot, with nothing yet valid.
+
+	Alters
+		Incoming
+			`c'.
+
+	Return Values
+		Explicit
+			returns the slot holding `block', or -1.
+
+	History
+		ag	16 oct 26
+ +*/
+int	dBase_CacheSlot(c, block, add)
+DF_CACHE *c;
+long	block;
+int	add;
+{
+	int	bucket = (int)(block & (DF_CACHE_HASH - 1)),
+		i;
+
+	for (i = c->hash[bucket] ; i >= 0 && c->block[i] != block ;
+		i = c->chain[i])
+		;
+	if (i < 0) {
+		int	*p;
+
+		if (!add) return -1;
+		/*
+			recycle the least recently used slot.
+		 */
+		i = c->tail;
+		if (c->block[i] >= 0L) {
+			for (p = &c->hash[(int)(c->block[i] &
+				(DF_CACHE_HASH - 1))] ; *p != i ;
+				p = &c->chain[*p])
+				;
+			*p = c->chain[i];
+		}
+		c->block[i] = block;
+		c->valid[i] = 0;
+		c->chain[i] = c->hash[bucket];
+		c->hash[bucket] = i;
+	}
+	if (i != c->head) {
+		/*
+			move to the front of the LRU list.
+		 */
+		c->next[c->prev[i]] = c->next[i];
+		if (i == c->tail)
+			c->tail = c->prev[i];
+		else
+			c->prev[c->next[i]] = c->prev[i];
+		c->prev[c->head] = i;
+		c->next[i] = c->head;
+		c->prev[i] = -1;
+		c->head = i;
+	}
+	return i;
+}
+
+/*+
+	dBase_MemoBytes()
+
+	Parameters
+		`d' is the info struct.
+		`off' is a byte offset in the .dbt.
+		`avail' receives the number of bytes available at `ptr'.
+
+	Description
+		find the .dbt bytes starting at `off'.  they come straight
+		out of the mapped .dbt, or out of the block cache, reading
+		a few blocks on a cache miss.  at most the rest of one
+		cached block is available at a time.
+
+	Calls
+		Local
+			dBase_CacheSlot(), dBase_ReadAt().
+
+	Return Values
+		Explicit
+			returns a pointer to the bytes; `avail' is 0 past
+			the end of the .dbt.
+
+	History
+		ag	16 oct 26
+ +*/
+char	*dBase_MemoBytes(d, off, avail)
+DF_INFO	*d;
+long	off,
+	*avail;
+{
+	DF_CACHE *c = d->cache;
+	long	block = off / (long)DBASE_MEMO_BLOCK;
+	int	in = (int)(off % (long)DBASE_MEMO_BLOCK),
+		i;
+
+	*avail = 0L;
+	if (d->dbt_map != (char *)NULL) {
+		if (off < d->dbt_map_len) *avail = d->dbt_map_len - off;
+		return d->dbt_map + off;
+	}
+
+	if ((i = dBase_CacheSlot(c, block, 0)) < 0) {
+		/*
+			a miss; read the blocks a memo usually needs.
+		 */
+		int	n = dBase_ReadAt(d->dbt, c->stage,
+				(long)DBASE_MAX_MEMO_BLOCKS * DBASE_MEMO_BLOCK,
+				block * (long)DBASE_MEMO_BLOCK),
+			b;
+
+		for (b = DBASE_MAX_MEMO_BLOCKS - 1 ; b >= 0 ; b--) {
+			int	have = n - (b * DBASE_MEMO_BLOCK);
+			if (have <= 0 && b > 0) continue;
+			i = dBase_CacheSlot(c, block + b, 1);
+			c->valid[i] = (have < 0 ? 0 :
+				(have > DBASE_MEMO_BLOCK ?
+				DBASE_MEMO_BLOCK : have));
+			memcpy(c->data + ((long)i * DBASE_MEMO_BLOCK),
+				c->stage + (b * DBASE_MEMO_BLOCK),
+				(size_t)c->valid[i]);
+		}
+	}
+	if (c->valid[i] > in) *avail = (long)(c->valid[i] - in);
+	return c->data + ((long)i * DBASE_MEMO_BLOCK) + in;
+}
+
+/*+
+	dBase_MemoRead()
+
+	Parameters
+		`d' is the info struct.
+		`off' is a byte offset in the memo file.
+		`buf' receives the bytes.
+		`len' is the number of bytes wanted.
+
+	Description
+		copy `len' memo file bytes starting at `off' into `buf',
+		across cached block boundaries if need be.
+
+	Calls
+		System
+			memcpy().
+		Local
+			dBase_MemoBytes().
+
+	Return Values
+		Explicit
+			returns the number of bytes copied; fewer than `len'
+			near the end of the memo file.
+
+	History
+		ag	16 oct 26
+ +*/
+int	dBase_MemoRead(d, off, buf, len)
+DF_INFO	*d;
+long	off;
+char	*buf;
+int	len;
+{
+	int	n = 0;
+	long	avail;
+
+	while (n < len) {
+		char	*src = dBase_MemoBytes(d, off + n, &avail);
+		if (avail <= 0L) break;
+		if (avail > (long)(len - n)) avail = (long)(len - n);
+		memcpy(buf + n, src, (size_t)avail);
+		n += (int)avail;
+	}
+	return n;
+}
+
+/*+
+	dBase_MemoAddr()
+
+	Parameters
+		`d' is the info struct.
+		`ptr' is the raw memo field in the record.
+		`len' is the width of the memo field.
+
+	Description
+		find the memo block number held in a memo field.
+		dBase and FoxPro write it in ASCII; Visual FoxPro
+		keeps it in a 4-byte binary field.
+
+	Calls
+		System
+			strncpy(), atol().
+		Local
+			dff_BytesToLong().
+
+	Return Values
+		Explicit
+			returns the memo block number, or -1 when the field
+			is blank or invalid.
+
+	History
+		ag	16 oct 26
+ +*/
+long	dBase_MemoAddr(d, ptr, len)
+DF_INFO	*d;
+char	*ptr;
+int	len;
+{
+	long	addr;
+
+	if (len == 4 && d->memo_type == DBASE_MEMO_FOX)
+		addr = dff_BytesToLong(ptr, 4);
+	else {
+		char	fld[32];
+
+		if (len > (int)sizeof(fld) - 1) len = sizeof(fld) - 1;
+		strncpy(fld, ptr, len);
+		fld[len] = '\0';
+		addr = atol(fld);
+	}
+	return (addr > 0L ? addr : -1L);
+}
+
+/*+
+	dBase_CompareLong()
+
+	Description
+		qsort() comparison of two longs.
+
+	History
+		ag	16 oct 26
+ +*/
+int	dBase_CompareLong(a, b)
+const void	*a;
+const void	*b;
+{
+	long	x = *(long *)a, y = *(long *)b;
+	return (x < y ? -1 : (x > y ? 1 : 0));
+}
+
+/*+
+	dBase_Prefetch()
+
+	Parameters
+		`d' is the info struct.
+
+	Description
+		collect the memo addresses of the next DF_PREFETCH_RECS
+		records, sort them, and merge neighbouring memos (up to
+		DF_PREFETCH_GAP unused blocks apart) into large ranges.
+		when the .dbt is mapped the ranges are handed to
+		madvise() in file order; otherwise each range is read
+		with one pread() into the block cache, skipping blocks
+		that are already cached.  only half of the cache is
+		filled per window, so prefetched blocks are not
+		evicted before they are used.
+
+	Calls
+		System
+			qsort(), madvise(), memcpy().
+		Local
+			dBase_ReadAt(), dBase_Filter(), dBase_MemoAddr(),
+			dBase_CacheSlot(), dBase_CompareLong().
+
+	Alters
+		Incoming
+			`d->prefetched', `d->cache'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dBase_Prefetch(d)
+DF_INFO	*d;
+{
+	long	*addr = (long *)d->peek_buffer,
+		rec,
+		n = 0L,
+		span = (long)DBASE_MAX_MEMO_BLOCKS + 1L,
+		limit = DF_CACHE_BLOCKS / 2;
+	char	*raw = d->peek_buffer +
+			(sizeof(long) * DF_PREFETCH_RECS * d->num_memo);
+
+	for (rec = d->rec_num ; rec < d->num_records &&
+		rec < d->rec_num + DF_PREFETCH_RECS &&
+		(n + d->num_memo) * span <= limit ; rec++) {
+		char	*ptr;
+		int	i;
+
+		if (d->dbf_map != (char *)NULL) {
+			long	at = d->data_offset + (rec * (long)d->bytes);
+			if (at + (long)d->bytes > d->dbf_map_len) break;
+			ptr = d->dbf_map + at;
+		} else if (dBase_ReadAt(d->dbf, ptr = raw, (long)d->bytes,
+			d->data_offset + (rec * (long)d->bytes)) != d->bytes)
+			break;
+
+		if (d->filter != (DF_TEST *)NULL &&
+			!dBase_Filter(d, d->filter_top, ptr))
+			/*
+				the memos of unwanted records are not read.
+			 */
+			continue;
+		for (i = 0 ; i < d->num_memo ; i++) {
+			long	at = dBase_MemoAddr(d,
+					ptr + d->memo_off[d->num_memo + i],
+					d->fld_len[d->memo_off[i]]);
+			if (at > 0L)
+				/*
+					in DBASE_MEMO_BLOCK units.
+				 */
+				addr[n++] = (at * d->memo_block) /
+					DBASE_MEMO_BLOCK;
+		}
+	}
+	d->prefetched = (rec > d->rec_num ? rec : d->rec_num + 1L);
+	if (n == 0L) return;
+
+	qsort((char *)addr, (size_t)n, sizeof(long), dBase_CompareLong);
+
+	{
+		long	i = 0L;
+
+		while (i < n) {
+			/*
+				merge the next run of nearby memos.
+			 */
+			long	first = addr[i],
+				last = addr[i] + span;
+
+			while (++i < n && addr[i] <= last + DF_PREFETCH_GAP &&
+				addr[i] + span - first <= DF_PREFETCH_MAX)
+				if (addr[i] + span > last)
+					last = addr[i] + span;
+
+			if (d->dbt_map != (char *)NULL) {
+#if defined(DF_HAVE_MMAP) && defined(MADV_WILLNEED)
+				long	page = (long)getpagesize(),
+					start = first * DBASE_MEMO_BLOCK,
+					end = last * DBASE_MEMO_BLOCK;
+
+				start -= start % page;
+				if (end > d->dbt_map_len) end = d->dbt_map_len;
+				if (start < end)
+					madvise((void *)(d->dbt_map + start),
+						(size_t)(end - start),
+						MADV_WILLNEED);
+#endif
+				continue;
+			}
+
+			{
+				DF_CACHE *c = d->cache;
+				int	got, b;
+
+				while (first < last &&
+					dBase_CacheSlot(c, first, 0) >= 0)
+					first++;
+				while (last > first &&
+					dBase_CacheSlot(c, last - 1, 0) >= 0)
+					last--;
+				if (first >= last) continue;
+
+				got = dBase_ReadAt(d->dbt, c->stage,
+					(last - first) * DBASE_MEMO_BLOCK,
+					first * DBASE_MEMO_BLOCK);
+				for (b = 0 ; b < (int)(last - first) ; b++) {
+					int	have = got -
+							(b * DBASE_MEMO_BLOCK),
+						slot;
+					if (have <= 0) break;
+					slot = dBase_CacheSlot(c, first + b, 1);
+					c->valid[slot] =
+						(have > DBASE_MEMO_BLOCK ?
+						DBASE_MEMO_BLOCK : have);
+					memcpy(c->data +
+						((long)slot * DBASE_MEMO_BLOCK),
+						c->stage +
+						(b * DBASE_MEMO_BLOCK),
+						(size_t)c->valid[slot]);
+				}
+			}
+		}
+	}
+}
+
+/*+
+	dBase_InitMemos()
+
+	Parameters
+		`d' is the info struct.
+
+	Description
+		note where the converted memo fields are in each record
+		for dBase_Prefetch(), and set up the .dbt block cache
+		when the .dbt is not mapped: it is spooled, or mmap()
+		failed.
+
+	Calls
+		System
+			malloc().
+		Local
+			dff_OutOfSpace().
+
+	Alters
+		Incoming
+			`d'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dBase_InitMemos(d)
+DF_INFO	*d;
+{
+	int	i, m;
+
+	if ((d->memo_off = (int *)malloc(sizeof(int) *
+		(2 * d->num_proj + 1))) == (int *)NULL)
+		dff_OutOfSpace(d);
+	for (d->num_memo = i = 0 ; i < d->num_proj ; i++)
+		if (d->plan[i].op == DF_STEP_MEMO)
+			d->memo_off[d->num_memo++] = d->plan[i].fld;
+	for (m = i = 0 ; i < d->num_proj ; i++)
+		if (d->plan[i].op == DF_STEP_MEMO)
+			d->memo_off[d->num_memo + m++] = d->plan[i].off;
+	if ((d->peek_buffer = (char *)malloc((sizeof(long) *
+		DF_PREFETCH_RECS * d->num_memo) + d->bytes + 1)) ==
+		(char *)NULL)
+		dff_OutOfSpace(d);
+
+	if (d->dbt_map == (char *)NULL) {
+		DF_CACHE *c;
+
+		if ((c = d->cache = (DF_CACHE *)malloc(sizeof(DF_CACHE))) ==
+			(DF_CACHE *)NULL ||
+			(c->block = (long *)malloc((sizeof(long) +
+			(4 * sizeof(int))) * DF_CACHE_BLOCKS)) == (long *)NULL ||
+			(c->data = (char *)malloc((long)DF_CACHE_BLOCKS *
+			DBASE_MEMO_BLOCK)) == (char *)NULL ||
+			(c->stage = (char *)malloc((long)DF_PREFETCH_MAX *
+			DBASE_MEMO_BLOCK)) == (char *)NULL)
+			dff_OutOfSpace(d);
+		c->valid = (int *)(c->block + DF_CACHE_BLOCKS);
+		c->next = c->valid + DF_CACHE_BLOCKS;
+		c->prev = c->next + DF_CACHE_BLOCKS;
+		c->chain = c->prev + DF_CACHE_BLOCKS;
+		for (i = 0 ; i < DF_CACHE_HASH ; i++)
+			c->hash[i] = -1;
+		for (i = 0 ; i < DF_CACHE_BLOCKS ; i++) {
+			c->block[i] = -1L;
+			c->valid[i] = 0;
+			c->chain[i] = -1;
+			c->next[i] = i + 1;
+			c->prev[i] = i - 1;
+		}
+		c->next[DF_CACHE_BLOCKS - 1] = -1;
+		c->head = 0;
+		c->tail = DF_CACHE_BLOCKS - 1;
+	}
+}
+
+/*+
+	dBase_MemoHead()
+
+	Parameters
+		`d' is the info struct.
+		`head' holds the DBASE_MEMO_HEADER bytes a dBase IV or
+		FoxPro memo starts with.
+
+	Description
+		get the length of a memo from its block header.
+
+	Calls
+		System
+			memcmp().
+		Local
+			dff_BytesToLong().
+
+	Return Values
+		Explicit
+			returns the memo length, or -1 if the header is
+			not a memo header.
+
+	History
+		ag	16 oct 26
+ +*/
+long	dBase_MemoHead(d, head)
+DF_INFO	*d;
+char	*head;
+{
+	if (d->memo_type == DBASE_MEMO_FOX)
+		return ((long)(head[4] & 0xff) << 24) |
+			((long)(head[5] & 0xff) << 16) |
+			((long)(head[6] & 0xff) << 8) |
+			(long)(head[7] & 0xff);
+	if (memcmp(head, DBASE4_MEMO_SIG, 4) == 0)
+		return dff_BytesToLong(&head[4], 4) - DBASE_MEMO_HEADER;
+	return -1L;
+}
+
+/*+
+	dBase_ProcessMemo()
+
+	Parameters
+		`d' is the info struct.
+		`addr' is the dBase memo address.
+
+	Description
+		streams the dBase memo, a chunk at a time, through
+		dff_TrimChunk() and into .dff blocks.  memos of any
+		length are converted whole in constant space.
+		the memo is taken from the mapped .dbt or the .dbt
+		block cache.  dBase IV and FoxPro memos are read for
+		exactly the length given in their block header.
+
+	Calls
+		Local
+			dBase_MemoRead(), dBase_MemoHead(),
+			dBase_MemoBytes(), dff_Open(), dff_TrimBegin(),
+			dff_TrimChunk(), dff_TrimEnd(), dff_PutBlocks(),
+			dff_EndBlocks().
+
+	Alters
+		Incoming
+			`d'.
+
+	Return Values
+		Explicit
+			returns exit code to the OS.
+
+	History
+		dw	15 dec 92
+ +*/
+void	dBase_ProcessMemo(d, addr)
+DF_INFO	*d;
+long	addr;
+{
+	char	*ptr = d->memo_buffer;
+	long	off = addr * (long)d->memo_block,
+		left = -1L,		/* memo length, when it is known */
+		avail;
+	DF_TRIM	trim;
+
+	if (d->dbt == (FILE *)NULL || addr <= 0L)
+		/*
+			either there *was* a memo field when no
+			memos were specified by the .dbf magic cookie,
+			or the memo field is blank or invalid (block 0
+			is the header of the memo file).
+			ignore the memo field for all cases.
+		 */
+		return;
+
+	if (d->memo_type != DBASE_MEMO_III) {
+		/*
+			dBase IV and FoxPro memos start with their
+			length, so no end marker need be looked for.
+		 */
+		char	head[DBASE_MEMO_HEADER];
+
+		if (dBase_MemoRead(d, off, head, DBASE_MEMO_HEADER) !=
+			DBASE_MEMO_HEADER)
+			return;
+		if ((left = dBase_MemoHead(d, head)) >= 0L)
+			off += DBASE_MEMO_HEADER;
+	}
+
+	if (d->cur->dff.fd < 0)
+		/*
+			open the output files if not already open.
+		 */
+		dff_Open(d);
+
+	/*
+		stream the memo through the trimmer into .dff
+		blocks, DF_MEMO_CHUNK bytes at a time.
+	 */
+	dff_TrimBegin(&trim, (left >= 0L));
+	while (!trim.done && left != 0L) {
+		char	*src = dBase_MemoBytes(d, off, &avail);
+		if (avail <= 0L) break;
+		if (avail > (long)DF_MEMO_CHUNK)
+			avail = (long)DF_MEMO_CHUNK;
+		if (left > 0L && avail > left)
+			avail = left;
+		dff_PutBlocks(d, ptr, dff_TrimChunk(&trim, src, (int)avail, ptr));
+		off += avail;
+		if (left > 0L) left -= avail;
+	}
+	if (!trim.done)
+		dff_PutBlocks(d, ptr, dff_TrimEnd(&trim, ptr));
+	dff_EndBlocks(d);
+}
+
+/*+
+	dBase_FindField()
+
+	Parameters
+		`d' is the info struct.
+		`name' is a field name or number (1..n) of `len' chars.
+
+	Description
+		look up a field named on the command line.  names are
+		matched without regard to case.
+
+	Calls
+		System
+			isdigit(), toupper(), strlen(), atoi().
+
+	Return Values
+		Explicit
+			returns the dBase field # (0..n-1), or -1 when
+			there is no such field.
+
+	History
+		ag	16 oct 26
+ +*/
+int	dBase_FindField(d, name, len)
+DF_INFO	*d;
+char	*name;
+int	len;
+{
+	int	i, fld = -1;
+
+	for (i = 0 ; i < len && isdigit(name[i]) ; i++)
+		;
+	if (len > 0 && i == len) {
+		/*
+			a field number.
+		 */
+		if ((fld = atoi(name) - 1) >= d->num_flds)
+			fld = -1;
+	} else for (i = 0 ; fld < 0 && i < d->num_flds ; i++) {
+		char	*fld_name = FieldName(d, i);
+		int	c;
+
+		if ((int)strlen(fld_name) != len) continue;
+		for (c = 0 ; c < len &&
+			toupper(fld_name[c]) == toupper(name[c]) ; c++)
+			;
+		if (c == len) fld = i;
+	}
+	return fld;
+}
+
+/*+
+	dBase_Project()
+
+	Parameters
+		`d' is the info struct.
+
+	Description
+		resolve the -f list of fields against the field
+		descriptors.  fields are named, or numbered 1..n, and
+		are converted in the order given.  without -f, every
+		field is converted.  the record buffer is sized for
+		the converted fields.
+
+	Calls
+		System
+			malloc(), fprintf(), printf().
+		Local
+			dBase_FindField(), dff_OutOfSpace(), dff_CleanUp().
+
+	Alters
+		Incoming
+			`d->proj', `d->num_proj', `d->out_buffer'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dBase_Project(d)
+DF_INFO	*d;
+{
+	char	*item = d->fields;
+	int	i, n = d->num_flds;
+	long	size = 1L;
+
+	if (item != (char *)NULL)
+		for (n = 1 ; *item != '\0' ; item++)
+			if (*item == ',') n++;
+	if ((d->proj = (int *)malloc(sizeof(int) * n)) == (int *)NULL)
+		dff_OutOfSpace(d);
+
+	if (d->fields == (char *)NULL)
+		for (d->num_proj = i = 0 ; i < d->num_flds ; i++)
+			d->proj[d->num_proj++] = i;
+	else for (d->num_proj = 0, item = d->fields ; *item != '\0' ; ) {
+		int	len, fld;
+
+		for (len = 0 ; item[len] != '\0' && item[len] != ',' ; len++)
+			;
+		if ((fld = dBase_FindField(d, item, len)) < 0) {
+			fprintf(stderr, "%s: no field `%.*s' to convert\n",
+				PROGNAME, len, item);
+			dff_CleanUp(d, DF_FAILURE);
+		}
+		d->proj[d->num_proj++] = fld;
+		if (*(item += len) == ',') item++;
+	}
+
+	if (d->num_proj == 0) {
+		fprintf(stderr, "%s: no fields to convert\n", PROGNAME);
+		dff_CleanUp(d, DF_FAILURE);
+	} else if (d->fields != (char *)NULL && FLAG_NOT_SET(d->flags.terse))
+		printf("converting %d fields\n", d->num_proj);
+
+	for (i = 0 ; i < d->num_proj ; i++)
+		size += d->fld_len[d->proj[i]] + DF_FLD_SLACK;
+	if ((d->out_buffer = (char *)malloc(sizeof(char) * size)) ==
+		(char *)NULL)
+		dff_OutOfSpace(d);
+}
+
+/*+
+	dBase_CompilePlan()
+
+	Parameters
+		`d' is the info struct.
+
+	Description
+		compile the field descriptors into the conversion plan
+		run by dBase_ProcessRecord(); each converted field gets
+		the step for its type, and its offset in the record.
+		the split field gets a step of its own, `d->key'.
+
+	Calls
+		System
+			malloc(), free().
+		Local
+			dff_OutOfSpace().
+
+	Alters
+		Incoming
+			`d->plan', `d->key'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dBase_CompilePlan(d)
+DF_INFO	*d;
+{
+	int	i, f, off,
+		*at;			/* offset of each dBase field */
+
+	if ((at = (int *)malloc(sizeof(int) * (d->num_flds + 1))) ==
+		(int *)NULL || (d->plan = (DF_STEP *)malloc(sizeof(DF_STEP) *
+		(d->num_proj + 1))) == (DF_STEP *)NULL)
+		dff_OutOfSpace(d);
+
+	for (off = 1, f = 0 ; f < d->num_flds ; off += d->fld_len[f++])
+		at[f] = off;
+
+	for (i = 0 ; i < d->num_proj ; i++) {
+		DF_STEP	*s = &d->plan[i];
+
+		s->fld = f = d->proj[i];
+		s->off = at[f];
+		s->len = d->fld_len[f];
+		if (d->fld_type[f] == DBASE_NUMERIC_FLD)
+			s->op = DF_STEP_NUMBER;
+		else if (d->fld_type[f] == DBASE_MEMO_FLD)
+			s->op = DF_STEP_MEMO;
+		else if (d->fld_type[f] == DBASE_LOGICAL_FLD && s->len == 1)
+			s->op = DF_STEP_LOGICAL;
+		else if (d->fld_type[f] == DBASE_DATE_FLD &&
+			s->len == DBASE_DATE_LEN)
+			s->op = DF_STEP_DATE;
+		else
+			s->op = DF_STEP_TEXT;
+	}
+
+	if (d->split != DF_NOT_SPLIT) {
+		d->key.op = DF_STEP_TEXT;
+		d->key.fld = d->split;
+		d->key.off = at[d->split];
+		d->key.len = d->fld_len[d->split];
+	}
+	free((char *)at);
+}
+
+/*+
+	dBase_NumberParts()
+
+	Parameters
+		`src' holds `len' bytes of a number.
+		`n' receives the parts of the number.
+
+	Description
+		find the sign, whole digits (less leading zeros) and
+		fraction digits (less trailing zeros) of a number,
+		for dBase_CompareNumber().  blanks come before and
+		after the number.  nothing is copied.
+
+	Alters
+		Incoming
+			`n'.
+
+	Return Values
+		Explicit
+			returns the number of bytes of `src' used; less
+			than `len' if anything else follows the number.
+
+	History
+		ag	16 oct 26
+ +*/
+int	dBase_NumberParts(src, len, n)
+char	*src;
+int	len;
+DF_NUM	*n;
+{
+	char	*p = src,
+		*end = src + len;
+
+	n->neg = 0;
+	while (p < end && *p == ' ') p++;
+	if (p < end && (*p == '-' || *p == '+'))
+		n->neg = (*p++ == '-');
+	while (p < end && *p == '0') p++;
+	for (n->whole = p ; p < end && *p >= '0' && *p <= '9' ; p++)
+		;
+	n->whole_len = p - n->whole;
+	n->frac = p;
+	n->frac_len = 0;
+	if (p < end && *p == '.') {
+		for (n->frac = ++p ; p < end && *p >= '0' && *p <= '9' ; p++)
+			;
+		for (n->frac_len = p - n->frac ; n->frac_len > 0 &&
+			n->frac[n->frac_len - 1] == '0' ; n->frac_len--)
+			;
+	}
+	if (n->whole_len == 0 && n->frac_len == 0)
+		/*
+			-0 is 0.
+		 */
+		n->neg = 0;
+	while (p < end && *p == ' ') p++;
+	return p - src;
+}
+
+/*+
+	dBase_FilterNumber()
+
+	Parameters
+		`src' holds the `len' bytes of a -w value.
+		`n' receives the parts of the number.
+
+	Description
+		a -w value compared with a numeric field must be a
+		number, with at least one digit; a blank dBase field
+		is 0, but a blank or bare sign value is a mistake.
+
+	Calls
+		Local
+			dBase_NumberParts().
+
+	Return Values
+		Explicit
+			returns non-zero if `src' is a number.
+
+	History
+		ag	16 oct 26
+ +*/
+int	dBase_FilterNumber(src, len, n)
+char	*src;
+int	len;
+DF_NUM	*n;
+{
+	int	i;
+
+	if (dBase_NumberParts(src, len, n) != len)
+		return 0;
+	for (i = 0 ; i < len ; i++)
+		if (src[i] >= '0' && src[i] <= '9')
+			return 1;
+	return 0;
+}
+
+/*+
+	dBase_CompareNumber()
+
+	Parameters
+		`a' and `b' are numbers from dBase_NumberParts().
+
+	Description
+		compare two decimal numbers exactly, digit by digit.
+
+	Calls
+		System
+			memcmp().
+
+	Return Values
+		Explicit
+			returns < 0, 0 or > 0 as `a' is less than, equal
+			to, or greater than `b'.
+
+	History
+		ag	16 oct 26
+ +*/
+int	dBase_CompareNumber(a, b)
+DF_NUM	*a, *b;
+{
+	int	sign = (a->neg ? -1 : 1),
+		c, i;
+
+	if (a->neg != b->neg)
+		return sign;
+	if (a->whole_len != b->whole_len)
+		return (a->whole_len < b->whole_len ? -sign : sign);
+	if ((c = memcmp(a->whole, b->whole, (size_t)a->whole_len)) != 0)
+		return (c < 0 ? -sign : sign);
+	for (i = 0 ; i < a->frac_len || i < b->frac_len ; i++) {
+		int	x = (i < a->frac_len ? a->frac[i] : '0'),
+			y = (i < b->frac_len ? b->frac[i] : '0');
+		if (x != y)
+			return (x < y ? -sign : sign);
+	}
+	return 0;
+}
+
+/*+
+	dBase_CompareText()
+
+	Parameters
+		`raw' is a text field of `len' bytes.
+		`val' is a value of `val_len' bytes.
+
+	Description
+		compare a blank-padded dBase text field with a value,
+		as though the value were padded with blanks too.
+
+	Calls
+		System
+			memcmp().
+
+	Return Values
+		Explicit
+			returns < 0, 0 or > 0 as the field is less than,
+			equal to, or greater than the value.
+
+	History
+		ag	16 oct 26
+ +*/
+int	dBase_CompareText(raw, len, val, val_len)
+char	*raw;
+int	len;
+char	*val;
+int	val_len;
+{
+	int	n = (len < val_len ? len : val_len),
+		c;
+
+	if ((c = memcmp(raw, val, (size_t)n)) != 0)
+		return c;
+	for ( ; n < len ; n++)
+		if (raw[n] != ' ')
+			return (raw[n] & 0xff) - ' ';
+	for ( ; n < val_len ; n++)
+		if (val[n] != ' ')
+			return ' ' - (val[n] & 0xff);
+	return 0;
+}
+
+/*+
+	dBase_FilterError()
+
+	Parameters
+		`d' is the info struct.
+		`at' is where the -w expression went wrong.
+		`why' says what was wrong.
+
+	Description
+		complain about the -w expression, and quit.
+
+	Calls
+		System
+			fprintf().
+		Local
+			dff_CleanUp().
+
+	History
+		ag	16 oct 26
+ +*/
+void	dBase_FilterError(d, at, why)
+DF_INFO	*d;
+char	*at,
+	*why;
+{
+	fprintf(stderr, "%s: -w %s at `%s'\n", PROGNAME, why,
+		(*at == '\0' ? "the end" : at));
+	dff_CleanUp(d, DF_FAILURE);
+}
+
+/*+
+	dBase_FilterTest()
+
+	Parameters
+		`d' is the info struct.
+		`at' points to the -w expression still to be compiled.
+
+	Description
+		compile one part of the -w expression: a field test,
+		`!' and a part, or a bracketed expression.  a field
+		test is a field name (or #) and a value, with one of:
+			=	equal (or lo..hi for a range)
+			!=	not equal
+			<, <=, >, >=	ordering
+			^=	starts with
+		values may be quoted with ' or ", and a quoted value
+		is never a range.  numeric fields are compared as
+		numbers, others byte by byte as stored.
+
+	Calls
+		System
+			isalnum(), strchr().
+		Local
+			dBase_FilterOr(), dBase_FilterError(),
+			dBase_FindField(), dBase_FilterNumber().
+
+	Alters
+		Incoming
+			`*at', `d->filter', `d->num_tests'.
+
+	Return Values
+		Explicit
+			returns the test # in `d->filter'.
+
+	History
+		ag	16 oct 26
+ +*/
+int	dBase_FilterTest(d, at)
+DF_INFO	*d;
+char	**at;
+{
+	DF_TEST	*t;
+	char	*p = *at,
+		*name;
+	int	i;
+
+	while (*p == ' ') p++;
+	if (*p == '(') {
+		*at = p + 1;
+		i = dBase_FilterOr(d, at);
+		for (p = *at ; *p == ' ' ; p++)
+			;
+		if (*p != ')') dBase_FilterError(d, p, "expected `)'");
+		*at = p + 1;
+		return i;
+	}
+
+	t = &d->filter[i = d->num_tests++];
+	if (*p == '!' && p[1] != '=') {
+		*at = p + 1;
+		t->op = DF_TEST_NOT;
+		t->left = dBase_FilterTest(d, at);
+		return i;
+	}
+
+	for (name = p ; isalnum((unsigned char)*p) || *p == '_' ; p++)
+		;
+	if (p == name) dBase_FilterError(d, p, "expected a field");
+	if ((t->fld = dBase_FindField(d, name, p - name)) < 0)
+		dBase_FilterError(d, name, "no such field");
+	if (d->fld_type[t->fld] == DBASE_MEMO_FLD)
+		dBase_FilterError(d, name, "cannot test a memo field");
+	t->num = (d->fld_type[t->fld] == DBASE_NUMERIC_FLD);
+	t->len = d->fld_len[t->fld];
+
+	while (*p == ' ') p++;
+	if (*p == '=') t->op = DF_TEST_EQ, p++;
+	else if (*p == '!' && p[1] == '=') t->op = DF_TEST_NE, p += 2;
+	else if (*p == '^' && p[1] == '=') t->op = DF_TEST_PREFIX, p += 2;
+	else if (*p == '<' && p[1] == '=') t->op = DF_TEST_LE, p += 2;
+	else if (*p == '>' && p[1] == '=') t->op = DF_TEST_GE, p += 2;
+	else if (*p == '<') t->op = DF_TEST_LT, p++;
+	else if (*p == '>') t->op = DF_TEST_GT, p++;
+	else dBase_FilterError(d, p, "expected a comparison");
+
+	while (*p == ' ') p++;
+	if (*p == '\'' || *p == '"') {
+		char	*end = strchr(p + 1, *p);
+
+		if (end == (char *)NULL)
+			dBase_FilterError(d, p, "unmatched quote");
+		t->hi = t->lo = p + 1;
+		t->hi_len = t->lo_len = end - t->lo;
+		p = end + 1;
+	} else {
+		int	n;
+
+		for (t->lo = p ; *p != '\0' && *p != '&' && *p != '|' &&
+			*p != ')' ; p++)
+			;
+		for (t->lo_len = p - t->lo ; t->lo_len > 0 &&
+			t->lo[t->lo_len - 1] == ' ' ; t->lo_len--)
+			;
+		t->hi = t->lo;
+		t->hi_len = t->lo_len;
+
+		/*
+			lo..hi is a range.
+		 */
+		for (n = 0 ; t->op == DF_TEST_EQ && n + 1 < t->lo_len ; n++)
+			if (t->lo[n] == '.' && t->lo[n + 1] == '.') {
+				t->op = DF_TEST_RANGE;
+				t->hi = t->lo + n + 2;
+				t->hi_len = t->lo_len - n - 2;
+				t->lo_len = n;
+			}
+	}
+	if (t->num && (t->op == DF_TEST_PREFIX ||
+		!dBase_FilterNumber(t->lo, t->lo_len, &t->lo_num) ||
+		!dBase_FilterNumber(t->hi, t->hi_len, &t->hi_num)))
+		dBase_FilterError(d, t->lo, "expected a number");
+
+	*at = p;
+	return i;
+}
+
+/*+
+	dBase_FilterAnd()
+
+	Parameters
+		`d' is the info struct.
+		`at' points to the -w expression still to be compiled.
+
+	Description
+		compile parts of the -w expression joined by `&'.
+
+	Calls
+		Local
+			dBase_FilterTest().
+
+	Alters
+		Incoming
+			`*at', `d->filter', `d->num_tests'.
+
+	Return Values
+		Explicit
+			returns the test # in `d->filter'.
+
+	History
+		ag	16 oct 26
+ +*/
+int	dBase_FilterAnd(d, at)
+DF_INFO	*d;
+char	**at;
+{
+	int	i = dBase_FilterTest(d, at);
+
+	for (;;) {
+		char	*p = *at;
+		DF_TEST	*t;
+
+		while (*p == ' ') p++;
+		if (*p != '&') break;
+		*at = p + 1;
+		t = &d->filter[d->num_tests];
+		t->op = DF_TEST_AND;
+		t->left = i;
+		i = d->num_tests++;
+		t->right = dBase_FilterTest(d, at);
+	}
+	return i;
+}
+
+/*+
+	dBase_FilterOr()
+
+	Parameters
+		`d' is the info struct.
+		`at' points to the -w expression still to be compiled.
+
+	Description
+		compile parts of the -w expression joined by `|'.
+
+	Calls
+		Local
+			dBase_FilterAnd().
+
+	Alters
+		Incoming
+			`*at', `d->filter', `d->num_tests'.
+
+	Return Values
+		Explicit
+			returns the test # in `d->filter'.
+
+	History
+		ag	16 oct 26
+ +*/
+int	dBase_FilterOr(d, at)
+DF_INFO	*d;
+char	**at;
+{
+	int	i = dBase_FilterAnd(d, at);
+
+	for (;;) {
+		char	*p = *at;
+		DF_TEST	*t;
+
+		while (*p == ' ') p++;
+		if (*p != '|') break;
+		*at = p + 1;
+		t = &d->filter[d->num_tests];
+		t->op = DF_TEST_OR;
+		t->left = i;
+		i = d->num_tests++;
+		t->right = dBase_FilterAnd(d, at);
+	}
+	return i;
+}
+
+/*+
+	dBase_CompileFilter()
+
+	Parameters
+		`d' is the info struct.
+
+	Description
+		compile the -w expression against the field layout,
+		so that dBase_Filter() can test the raw records.
+
+	Calls
+		System
+			malloc(), strlen().
+		Local
+			dBase_FilterOr(), dBase_FilterError(),
+			dff_OutOfSpace().
+
+	Alters
+		Incoming
+			`d->filter', `d->num_tests', `d->filter_top'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dBase_CompileFilter(d)
+DF_INFO	*d;
+{
+	char	*at = d->where;
+	int	i, off;
+
+	/*
+		every test uses at least one char of the expression.
+	 */
+	if ((d->filter = (DF_TEST *)malloc(sizeof(DF_TEST) *
+		(strlen(d->where) + 1))) == (DF_TEST *)NULL)
+		dff_OutOfSpace(d);
+	d->num_tests = 0;
+	d->filter_top = dBase_FilterOr(d, &at);
+	while (*at == ' ') at++;
+	if (*at != '\0')
+		dBase_FilterError(d, at, "unexpected");
+
+	for (i = 0 ; i < d->num_tests ; i++)
+		if (d->filter[i].op < DF_TEST_AND) {
+			int	f;
+			for (off = 1, f = 0 ; f < d->filter[i].fld ; f++)
+				off += d->fld_len[f];
+			d->filter[i].off = off;
+		}
+}
+
+/*+
+	dBase_Filter()
+
+	Parameters
+		`d' is the info struct.
+		`test' is the test # in `d->filter'.
+		`ptr' is the dBase record.
+
+	Description
+		run the -w test on the raw record; `&' and `|' stop
+		as soon as the answer is known.
+
+	Calls
+		System
+			memcmp().
+		Local
+			dBase_NumberParts(), dBase_CompareNumber(),
+			dBase_CompareText().
+
+	Return Values
+		Explicit
+			returns non-zero when the record passes the test.
+
+	History
+		ag	16 oct 26
+ +*/
+int	dBase_Filter(d, test, ptr)
+DF_INFO	*d;
+int	test;
+char	*ptr;
+{
+	DF_TEST	*t = &d->filter[test];
+	char	*raw;
+	int	lo, hi;
+
+	switch (t->op) {
+		case DF_TEST_AND:
+			return dBase_Filter(d, t->left, ptr) &&
+				dBase_Filter(d, t->right, ptr);
+		case DF_TEST_OR:
+			return dBase_Filter(d, t->left, ptr) ||
+				dBase_Filter(d, t->right, ptr);
+		case DF_TEST_NOT:
+			return !dBase_Filter(d, t->left, ptr);
+	}
+
+	raw = ptr + t->off;
+	if (t->op == DF_TEST_PREFIX)
+		return t->lo_len <= t->len &&
+			memcmp(raw, t->lo, (size_t)t->lo_len) == 0;
+	if (t->num) {
+		DF_NUM	n;
+
+		dBase_NumberParts(raw, t->len, &n);
+		lo = dBase_CompareNumber(&n, &t->lo_num);
+		hi = (t->op == DF_TEST_RANGE ?
+			dBase_CompareNumber(&n, &t->hi_num) : lo);
+	} else {
+		lo = dBase_CompareText(raw, t->len, t->lo, t->lo_len);
+		hi = (t->op == DF_TEST_RANGE ?
+			dBase_CompareText(raw, t->len, t->hi, t->hi_len) : lo);
+	}
+
+	switch (t->op) {
+		case DF_TEST_EQ:	return lo == 0;
+		case DF_TEST_NE:	return lo != 0;
+		case DF_TEST_LT:	return lo < 0;
+		case DF_TEST_LE:	return lo <= 0;
+		case DF_TEST_GT:	return lo > 0;
+		case DF_TEST_GE:	return lo >= 0;
+		default:		return lo >= 0 && hi <= 0;
+	}
+}
+
+/*+
+	dBase_Number()
+
+	Parameters
+		`src' is a numeric field of `len' bytes.
+		`dst' receives the number; it must have room for
+			`len' + 2 bytes.
+
+	Description
+		get numbers into smallest possible space, exactly.
+		the digits of the field are copied without leading
+		zeros in the whole part or trailing zeros in the
+		fraction; a zero number is left blank.  a field that
+		is not plain [-]digits[.digits] is copied as it is,
+		less its blanks, unless atof() finds it 0.  so `dst'
+		never gets more than `len' + 1 bytes, and no printf()
+		is used.
+
+	Calls
+		System
+			atof().
+
+	Return Values
+		Explicit
+			returns the length of the NUL-terminated `dst'.
+
+	History
+		ag	16 oct 26
+ +*/
+int	dBase_Number(src, len, dst)
+char	*src;
+int	len;
+char	*dst;
+{
+	char	*end = src + len,
+		*out = dst,
+		*whole, *point = (char *)NULL, *p;
+	int	neg = 0;
+
+	while (src < end && *src == ' ') src++;
+	for (p = src ; p < end && *p != '\0' ; p++)
+		;
+	while (p > src && p[-1] == ' ') p--;
+	end = p;
+
+	whole = src;
+	if (whole < end && (*whole == '-' || *whole == '+'))
+		neg = (*whole++ == '-');
+	for (p = whole ; p < end ; p++)
+		if (*p == '.' && point == (char *)NULL)
+			point = p;
+		else if (*p < '0' || *p > '9')
+			break;
+
+	if (p < end) {
+		/*
+			not a plain dBase number; keep what is there.
+		 */
+		for (p = dst ; src < end ; )
+			*p++ = *src++;
+		*p = '\0';
+		if (atof(dst) == 0.0)
+			/*
+				leave the field blank
+			 */
+			*dst = '\0';
+		return strlen(dst);
+	}
+
+	if (point == (char *)NULL) point = end;
+	while (whole < point && *whole == '0') whole++;
+	while (end > point + 1 && end[-1] == '0') end--;
+	if (end == point + 1) end = point;
+
+	if (whole == point && end == point) {
+		/*
+			zero; leave the field blank
+		 */
+		*dst = '\0';
+		return 0;
+	}
+	if (neg) *out++ = '-';
+	if (whole == point) *out++ = '0';
+	while (whole < end) *out++ = *whole++;
+	*out = '\0';
+	return out - dst;
+}
+
+/*+
+	dBase_RangeKey()
+
+	Parameters
+		`d' is the info struct.
+		`fld' holds `len' bytes of trimmed split field text.
+		`key' receives the field value.
+
+	Description
+		get the value -k rN ranges are made of.  numeric fields
+		that are blank (or not numbers) sort first.
+
+	Calls
+		System
+			strtod().
+
+	Alters
+		Incoming
+			`key'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dBase_RangeKey(d, fld, len, key)
+DF_INFO		*d;
+char		*fld;
+int		len;
+DF_BOUND	*key;
+{
+	key->text = fld;
+	key->num = 0.0;
+	if (d->fld_type[d->key.fld] == DBASE_NUMERIC_FLD) {
+		char	*end;
+
+		key->num = strtod(fld, &end);
+		if (len == 0 || end == fld) key->num = -HUGE_VAL;
+	}
+}
+
+/*+
+	dBase_CompareBound()
+
+	Description
+		qsort() comparison of two split field values.
+
+	Calls
+		System
+			strcmp().
+
+	History
+		ag	16 oct 26
+ +*/
+int	dBase_CompareBound(a, b)
+const void	*a;
+const void	*b;
+{
+	DF_BOUND	*x = (DF_BOUND *)a, *y = (DF_BOUND *)b;
+
+	if (x->num != y->num) return (x->num < y->num ? -1 : 1);
+	return strcmp(x->text, y->text);
+}
+
+/*+
+	dBase_Sample()
+
+	Parameters
+		`d' is the info struct.
+
+	Description
+		choose the -k rN ranges.  the split field of up to
+		DF_SAMPLE_RECS records, spread evenly over the .dbf, is
+		sorted, and every (n/N)th value starts a new range.
+		records that will not be converted are not sampled.
+		the ranges are written to the `model'.dfr manifest and
+		become the output parts.
+
+	Calls
+		System
+			malloc(), free(), qsort(), strcpy(), fopen(),
+			fprintf(), fclose(), printf(), sprintf().
+		Local
+			dBase_ReadAt(), dBase_Filter(), dff_TrimSpan(),
+			dBase_RangeKey(), dBase_CompareBound(),
+			dff_AddPart(), dff_FileAndExt(), dff_OutOfSpace(),
+			Dfile_WriteComment(), CheckDiskSpace().
+
+	Alters
+		Incoming
+			`d->bound', `d->num_bounds', `d->part'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dBase_Sample(d)
+DF_INFO	*d;
+{
+	DF_STEP		*s = &d->key;
+	DF_BOUND	*sample;
+	char		*text, name[32];
+	long		rec,
+			step = d->num_records / DF_SAMPLE_RECS + 1L;
+	int		n = 0, i, width;
+	FILE		*fp;
+
+	if ((sample = (DF_BOUND *)malloc(sizeof(DF_BOUND) *
+		(DF_SAMPLE_RECS + 1))) == (DF_BOUND *)NULL ||
+		(text = (char *)malloc((size_t)(DF_SAMPLE_RECS + 1) *
+		(s->len + 1))) == (char *)NULL)
+		dff_OutOfSpace(d);
+
+	for (rec = 0L ; rec < d->num_records && n <= DF_SAMPLE_RECS ;
+		rec += step) {
+		char	*ptr,
+			*fld = text + (long)n * (s->len + 1);
+		long	at = d->data_offset + (rec * (long)d->bytes);
+
+		if (d->dbf_map != (char *)NULL) {
+			if (at + (long)d->bytes > d->dbf_map_len) break;
+			ptr = d->dbf_map + at;
+		} else if (dBase_ReadAt(d->dbf, ptr = d->rec_buffer,
+			(long)d->bytes, at) != d->bytes)
+			break;
+
+		if ((ptr[0] == DBASE_DELETED &&
+			FLAG_NOT_SET(d->flags.undel)) ||
+			(d->filter != (DF_TEST *)NULL &&
+			!dBase_Filter(d, d->filter_top, ptr)))
+			continue;
+		dBase_RangeKey(d, fld, dff_TrimSpan(ptr + s->off, s->len,
+			fld), &sample[n++]);
+	}
+	qsort((char *)sample, (size_t)n, sizeof(DF_BOUND),
+		dBase_CompareBound);
+
+	if ((d->bound = (DF_BOUND *)malloc(sizeof(DF_BOUND) *
+		(d->key_arg + 1))) == (DF_BOUND *)NULL)
+		dff_OutOfSpace(d);
+	for (i = 1 ; i < d->key_arg ; i++) {
+		DF_BOUND	*b = &sample[(long)i * n / d->key_arg];
+
+		if (b >= &sample[n] || (d->num_bounds > 0 ?
+			dBase_CompareBound(b, &d->bound[d->num_bounds - 1]) :
+			dBase_CompareBound(b, &sample[0])) <= 0)
+			/*
+				too few distinct values for a new range.
+			 */
+			continue;
+		if ((d->bound[d->num_bounds].text = (char *)malloc(
+			strlen(b->text) + 1)) == (char *)NULL)
+			dff_OutOfSpace(d);
+		strcpy(d->bound[d->num_bounds].text, b->text);
+		d->bound[d->num_bounds++].num = b->num;
+	}
+	free(text);
+	free((char *)sample);
+
+	/*
+		one part per range, and the manifest.
+	 */
+	if ((fp = fopen(dff_FileAndExt(d, d->model, DF_RNG_EXT), "w")) ==
+		(FILE *)NULL)
+		dff_OutOfSpace(d);
+	Dfile_WriteComment(fp, "Dfile Version");
+	fprintf(fp, "char\tVersion\t{%s}\n", DF_VERSION_STRING);
+	Dfile_WriteComment(fp, "Dfile Model name");
+	fprintf(fp, "char\tModel\t{%s}\n", d->model);
+	fprintf(fp, "char\tSplitField\t{%s}\n", FieldName(d, s->fld));
+	fprintf(fp, "int\tNumRanges\t%d\n", d->num_bounds + 1);
+	Dfile_WriteComment(fp,
+		"file, first value, first value past the range ({} if none)");
+	fprintf(fp, "char\tRanges[NumRanges][3]\n");
+	width = sprintf(name, "%d", d->num_bounds);
+	for (i = 0 ; i <= d->num_bounds ; i++) {
+		sprintf(name, "%0*d", width, i);
+		dff_AddPart(d, name);
+		fprintf(fp, "{%s}\t{%s}\t{%s}\n", name,
+			(i > 0 ? d->bound[i - 1].text : ""),
+			(i < d->num_bounds ? d->bound[i].text : ""));
+	}
+	CheckDiskSpace(d, fp);
+	fclose(fp);
+	d->cur = &d->part[d->indx = 0];
+
+	if (FLAG_NOT_SET(d->flags.terse))
+		printf("%d ranges from %d sampled records\n",
+			d->num_bounds + 1, n);
+}
+
+/*+
+	dBase_SplitKey()
+
+	Parameters
+		`d' is the info struct.
+		`ptr' is the dBase record, past its deleted flag.
+
+	Description
+		find the .dff/.dfa file a record goes into from its
+		(trimmed) split field.
+
+	Calls
+		Local
+			dff_TrimSpan(), dBase_KeyPart().
+
+	Return Values
+		Explicit
+			returns the split file index.
+
+	History
+		ag	16 oct 26
+ +*/
+int	dBase_SplitKey(d, ptr)
+DF_INFO	*d;
+char	*ptr;
+{
+	DF_STEP	*s = &d->key;
+
+	return dBase_KeyPart(d, d->fld_buffer, dff_TrimSpan(ptr + s->off - 1,
+		s->len, d->fld_buffer));
+}
+
+/*+
+	dBase_KeyPart()
+
+	Parameters
+		`d' is the info struct.
+		`fld' holds the `len' bytes of trimmed split field
+		text, NUL-terminated.
+
+	Description
+		find the .dff/.dfa file a split field value goes into:
+		by its 1st char, or by the -k prefix, hash, bucket or
+		range.  the range is found by a binary search of
+		`d->bound'.
+
+	Calls
+		System
+			isdigit(), isalnum(), tolower(), strcpy(), strtod(),
+			floor(), sprintf().
+		Local
+			dff_FindPart(), dff_FormatLong(), dBase_RangeKey(),
+			dBase_CompareBound().
+
+	Return Values
+		Explicit
+			returns the split file index.
+
+	History
+		ag	16 oct 26
+ +*/
+int	dBase_KeyPart(d, fld, len)
+DF_INFO	*d;
+char	*fld;
+int	len;
+{
+	DF_STEP	*s = &d->key;
+	char	name[DF_KEY_LEN + 24];
+	int	indx;
+
+	switch (d->key_how) {
+		case DF_KEY_PREFIX:
+			for (indx = 0 ; indx < len && indx < d->key_arg ;
+				indx++) {
+				int	c = fld[indx] & 0xff;
+
+				name[indx] = (char)(isalnum(c) ?
+					tolower(c) : '_');
+			}
+			name[indx] = '\0';
+			return dff_FindPart(d, (indx > 0 ? name :
+				DF_OTHER_NAME));
+		case DF_KEY_HASH: {
+			unsigned long	h = 2166136261UL;
+
+			for (indx = 0 ; indx < len ; indx++)
+				h = ((h ^ (unsigned long)(fld[indx] & 0xff)) *
+					16777619UL) & 0xffffffffUL;
+			return (int)(h % (unsigned long)d->key_arg);
+		}
+		case DF_KEY_BUCKET:
+			if (d->fld_type[s->fld] == DBASE_DATE_FLD) {
+				long	month;
+
+				for (indx = 0 ; indx < len &&
+					isdigit(fld[indx]) ; indx++)
+					;
+				if (len != DBASE_DATE_LEN ||
+					indx != DBASE_DATE_LEN ||
+					(month = (fld[4] - '0') * 10L +
+					(fld[5] - '0')) < 1L || month > 12L)
+					return dff_FindPart(d, DF_OTHER_NAME);
+				month += atol(fld) / 10000L * 12L - 1L;
+				month -= month % d->key_arg;
+				sprintf(name, "%04ld%02ld", month / 12L,
+					month % 12L + 1L);
+			} else {
+				char	*end;
+				double	value = strtod(fld, &end);
+
+				if (end == fld)
+					return dff_FindPart(d, DF_OTHER_NAME);
+				name[dff_FormatLong(name, (long)floor(value /
+					d->key_arg) * d->key_arg)] = '\0';
+				if (name[0] == '-') name[0] = 'm';
+			}
+			return dff_FindPart(d, name);
+		case DF_KEY_RANGE: {
+			DF_BOUND	key;
+			int		lo = 0,
+					hi = d->num_bounds;
+
+			/*
+				the number of range starts <= `key'.
+			 */
+			dBase_RangeKey(d, fld, len, &key);
+			while (lo < hi) {
+				int	mid = (lo + hi) / 2;
+
+				if (dBase_CompareBound(&key,
+					&d->bound[mid]) < 0)
+					hi = mid;
+				else
+					lo = mid + 1;
+			}
+			return lo;
+		}
+	}
+
+	if (isdigit(fld[0]))
+		/*
+			digit fields go into
+			DF_NUMBER_FILE.
+		 */
+		indx = DF_NUMBER_FILE;
+	else if ((indx = tolower(fld[0]) - 'a') < 0 ||
+		indx >= DF_MAX_SPLIT)
+		/*
+			non-alpha go into the
+			DF_OTHER_NAME file.
+		 */
+		indx = DF_OTHER_FILE;
+	return indx;
+}
+
+/*+
+	dBase_DecodeStep()
+
+	Parameters
+		`s' is a plan step other than DF_STEP_MEMO.
+		`raw' is the step's field in the dBase record.
+		`out' is where the Dfile text goes.
+
+	Description
+		convert one field of a record into Dfile format.
+
+	Calls
+		System
+			memcpy().
+		Local
+			dBase_Number(), dff_TrimSpan().
+
+	Return Values
+		Explicit
+			returns the length of the text at `out'.
+
+	History
+		ag	16 oct 26
+ +*/
+int	dBase_DecodeStep(s, raw, out)
+DF_STEP	*s;
+char	*raw,
+	*out;
+{
+	int	n;
+
+	switch (s->op) {
+		case DF_STEP_NUMBER:
+			return dBase_Number(raw, s->len, out);
+		case DF_STEP_LOGICAL:
+			if (DF_PLAIN(raw[0])) {
+				/*
+					nothing to trim.
+				 */
+				*out = raw[0];
+				return 1;
+			}
+			break;
+		case DF_STEP_DATE:
+			for (n = 0 ; n < DBASE_DATE_LEN &&
+				raw[n] >= '0' && raw[n] <= '9' ; n++)
+				;
+			if (n == DBASE_DATE_LEN) {
+				/*
+					nothing to trim.
+				 */
+				memcpy(out, raw, (size_t)n);
+				return n;
+			}
+			break;
+	}
+	/*
+		remove special dBase chars and get
+		into smallest space.
+	 */
+	return dff_TrimSpan(raw, s->len, out);
+}
+
+/*+
+	dBase_ProcessRecord()
+
+	Parameters
+		`d' is the info struct.
+
+	Description
+		reads the next dBase record and processes all of its
+		fields, then writes them to the .dff file and updates
+		the .dfa file with the starting .dff block of the Dfile record.
+		the fields are converted by running the plan compiled
+		by dBase_CompilePlan().  when splitting, the .dff file is
+		chosen before any of the record is written.
+
+	Calls
+		System
+			printf().
+		Local
+			dBase_Prefetch(), dBase_GetRecord(), dBase_Filter(),
+			dBase_SplitKey(), dff_UsePart(), dBase_DecodeStep(),
+			dBase_MemoAddr(), dBase_ProcessMemo(), dff_FormatLong(),
+			dff_WriteBlocks(), dff_Progress().
+
+	Alters
+		Incoming
+			`d'.
+
+	History
+		dw	15 dec 92
+ +*/
+void	dBase_ProcessRecord(d)
+DF_INFO	*d;
+{
+	DF_STEP	*s, *last;
+	char	*ptr,
+		*out = d->out_buffer;		/* end of the record so far */
+
+	if (d->num_memo > 0 && d->rec_num >= d->prefetched)
+		/*
+			fetch the memos of the next few records
+			in .dbt order.
+		 */
+		dBase_Prefetch(d);
+	ptr = dBase_GetRecord(d);
+
+	if (*ptr++ == DBASE_DELETED && FLAG_NOT_SET(d->flags.undel)) {
+		/*
+			not restoring deleted records.
+			return.
+		 */
+		if (FLAG_NOT_SET(d->flags.terse))
+			printf("\n%s: skipping %ld - use -u flag to keep\n",
+				PROGNAME, d->rec_num);
+		return;
+	}
+
+	if (d->filter != (DF_TEST *)NULL &&
+		!dBase_Filter(d, d->filter_top, ptr - 1))
+		/*
+			not wanted; nothing of the record is decoded.
+		 */
+		return;
+
+	if (d->split != DF_NOT_SPLIT) {
+		/*
+			set the indx file from the split field.
+			every .dff file stays open, so the record
+			simply goes to the one it belongs in.
+		 */
+		dff_UsePart(d, dBase_SplitKey(d, ptr));
+	}
+
+	/*
+		get fields into Dfile format, a plan step at a time,
+		appending each to the record at `out'.
+	 */
+	for (s = d->plan, last = s + d->num_proj - 1 ; s <= last ; s++) {
+		char	*raw = ptr + s->off - 1;
+
+		switch (s->op) {
+			case DF_STEP_MEMO: {
+				long	old_start = d->cur->physical;
+
+				/*
+					add the memo text to the .dff file
+				 */
+				dBase_ProcessMemo(d,
+					dBase_MemoAddr(d, raw, s->len));
+				/*
+					add the physical memo address
+					to the memo field.
+				 */
+				out += dff_FormatLong(out,
+					(d->cur->physical == old_start ?
+					DF_FREELIST : old_start + 1L));
+				break;
+			}
+			default:
+				out += dBase_DecodeStep(s, raw, out);
+				break;
+		}
+
+		if (s < last)
+			/*
+				the last field is not delimited
+			 */
+			*out++ = DF_DELIM;
+	}
+	*out = '\0';
+
+	dff_WriteBlocks(d, d->out_buffer, out - d->out_buffer,
+		DF_WRITING_RECORD);
+	dff_Progress(d, d->rec_num);
+}
+
+/*+
+	dBase_JobRoom()
+
+	Parameters
+		`job' is a -j job.
+		`len' is the number of bytes wanted.
+
+	Description
+		make room for `len' more bytes of text in `job'.
+
+	Calls
+		System
+			realloc().
+
+	Alters
+		Incoming
+			`job->text', `job->text_size', `job->failed'.
+
+	Return Values
+		Explicit
+			returns 0 when out of memory, otherwise 1.
+
+	History
+		ag	16 oct 26
+ +*/
+int	dBase_JobRoom(job, len)
+DF_JOB	*job;
+long	len;
+{
+	long	size = job->text_size;
+	char	*text;
+
+	if (job->text_used + len <= size) return 1;
+	if ((size *= 2L) < job->text_used + len)
+		size = job->text_used + len;
+	if ((text = (char *)realloc(job->text, (size_t)size)) ==
+		(char *)NULL) {
+		job->failed = DF_JOB_NOSPACE;
+		return 0;
+	}
+	job->text = text;
+	job->text_size = size;
+	return 1;
+}
+
+/*+
+	dBase_JobMemoBytes()
+
+	Parameters
+		`job' is a -j job.
+		`off' is a byte offset in the .dbt.
+		`avail' receives the number of bytes available at `ptr'.
+
+	Description
+		find the .dbt bytes starting at `off' for a job:
+		straight out of the mapped .dbt, or read into the job's
+		own `stage'.  the .dbt block cache is not shared
+		between threads.
+
+	Calls
+		Local
+			dBase_ReadAt().
+
+	Return Values
+		Explicit
+			returns a pointer to the bytes; `avail' is 0 past
+			the end of the .dbt.
+
+	History
+		ag	16 oct 26
+ +*/
+char	*dBase_JobMemoBytes(job, off, avail)
+DF_JOB	*job;
+long	off,
+	*avail;
+{
+	DF_INFO	*d = job->src;
+	int	n;
+
+	*avail = 0L;
+	if (d->dbt_map != (char *)NULL) {
+		if (off < d->dbt_map_len) *avail = d->dbt_map_len - off;
+		return d->dbt_map + off;
+	}
+	if ((n = dBase_ReadAt(d->dbt, job->stage, (long)DF_MEMO_CHUNK,
+		off)) > 0)
+		*avail = (long)n;
+	return job->stage;
+}
+
+/*+
+	dBase_JobMemo()
+
+	Parameters
+		`job' is a -j job.
+		`m' receives the memo.
+		`addr' is the dBase memo address.
+
+	Description
+		add the trimmed text of a memo to the job, just as
+		dBase_ProcessMemo() would write it.
+
+	Calls
+		System
+			memcpy().
+		Local
+			dBase_JobMemoBytes(), dBase_MemoHead(),
+			dBase_JobRoom(), dff_TrimBegin(), dff_TrimChunk(),
+			dff_TrimEnd().
+
+	Alters
+		Incoming
+			`job', `m'.
+
+	Return Values
+		Explicit
+			returns 0 when out of memory, otherwise 1.
+
+	History
+		ag	16 oct 26
+ +*/
+int	dBase_JobMemo(job, m, addr)
+DF_JOB	*job;
+DF_JOBMEMO *m;
+long	addr;
+{
+	DF_INFO	*d = job->src;
+	long	off = addr * (long)d->memo_block,
+		left = -1L,		/* memo length, when it is known */
+		avail;
+	DF_TRIM	trim;
+
+	m->len = -1L;
+	if (d->dbt == (FILE *)NULL || addr <= 0L)
+		/*
+			no memo; see dBase_ProcessMemo().
+		 */
+		return 1;
+
+	if (d->memo_type != DBASE_MEMO_III) {
+		char	head[DBASE_MEMO_HEADER],
+			*src = dBase_JobMemoBytes(job, off, &avail);
+
+		if (avail < (long)DBASE_MEMO_HEADER)
+			return 1;
+		memcpy(head, src, (size_t)DBASE_MEMO_HEADER);
+		if ((left = dBase_MemoHead(d, head)) >= 0L)
+			off += DBASE_MEMO_HEADER;
+	}
+
+	m->text = job->text_used;
+	dff_TrimBegin(&trim, (left >= 0L));
+	while (!trim.done && left != 0L) {
+		char	*src = dBase_JobMemoBytes(job, off, &avail);
+		if (avail <= 0L) break;
+		if (avail > (long)DF_MEMO_CHUNK)
+			avail = (long)DF_MEMO_CHUNK;
+		if (left > 0L && avail > left)
+			avail = left;
+		if (!dBase_JobRoom(job, avail + 2L)) return 0;
+		job->text_used += dff_TrimChunk(&trim, src, (int)avail,
+			job->text + job->text_used);
+		off += avail;
+		if (left > 0L) left -= avail;
+	}
+	if (!trim.done) {
+		if (!dBase_JobRoom(job, 2L)) return 0;
+		job->text_used += dff_TrimEnd(&trim,
+			job->text + job->text_used);
+	}
+	m->len = job->text_used - m->text;
+	return 1;
+}
+
+/*+
+	dBase_JobRead()
+
+	Parameters
+		`job' is a -j or -l job.
+		`ahead' is non-zero to fault the records in, and ask
+		for their memos, before they are converted.
+
+	Description
+		read the job's dBase records with one positioned read,
+		or just check that the mapped .dbf holds them.  a piped
+		.dbf is read in order.
+		`job->have' is set to the number of whole records
+		found, and `job->bad_len' to the bytes of the record
+		after them.
+
+	Calls
+		System
+			madvise(), posix_fadvise(), fileno(), getpagesize(),
+			fread().
+		Local
+			dBase_ReadAt(), dBase_JobRecord(), dBase_MemoAddr().
+
+	Alters
+		Incoming
+			`job'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dBase_JobRead(job, ahead)
+DF_JOB	*job;
+int	ahead;
+{
+	DF_INFO	*d = job->src;
+	long	start = d->data_offset + (job->first * (long)d->bytes),
+		len = (job->last - job->first) * (long)d->bytes,
+		n,
+		rec;
+
+	if (d->dbf_map != (char *)NULL) {
+		if ((n = d->dbf_map_len - start) > len) n = len;
+		if (n < 0L) n = 0L;
+#ifdef	DF_HAVE_MMAP
+		if (ahead) {
+			/*
+				touch every page, so the conversion
+				does not wait for them.
+			 */
+			volatile char	sink;
+			long		page = (long)getpagesize(),
+					off;
+
+			for (off = 0L ; off < n ; off += page)
+				sink = d->dbf_map[start + off];
+			(void)sink;
+		}
+#endif
+	} else if (FLAG_SET(d->flags.dbf_pipe))
+		/*
+			a pipe: the jobs are read one after another.
+		 */
+		n = (long)fread(job->raw, 1, (size_t)len, d->dbf);
+	else if ((n = (long)dBase_ReadAt(d->dbf, job->raw, len,
+		start)) < 0L)
+		n = 0L;
+	job->have = n / (long)d->bytes;
+	job->bad_len = n % (long)d->bytes;
+
+	if (!ahead || d->dbt == (FILE *)NULL || job->nm == 0)
+		return;
+	for (rec = job->first ; rec < job->first + job->have ; rec++) {
+		/*
+			ask for the memos of the records.
+		 */
+		char	*ptr = dBase_JobRecord(job, rec) + 1;
+		DF_STEP	*s, *last;
+
+		for (s = d->plan, last = s + d->num_proj ; s < last ; s++) {
+			long	addr;
+
+			if (s->op != DF_STEP_MEMO ||
+				(addr = dBase_MemoAddr(d, ptr + s->off - 1,
+				s->len)) <= 0L)
+				continue;
+			addr *= (long)d->memo_block;
+#if defined(DF_HAVE_MMAP) && defined(MADV_WILLNEED)
+			if (d->dbt_map != (char *)NULL) {
+				long	page = (long)getpagesize(),
+					from = addr - (addr % page),
+					len = addr - from + DF_MEMO_CHUNK;
+
+				if (from + len > d->dbt_map_len)
+					len = d->dbt_map_len - from;
+				if (len > 0L)
+					madvise((void *)(d->dbt_map + from),
+						(size_t)len, MADV_WILLNEED);
+				continue;
+			}
+#endif
+#if defined(DF_HAVE_MMAP) && defined(POSIX_FADV_WILLNEED)
+			(void)posix_fadvise(fileno(d->dbt), (off_t)addr,
+				(off_t)DF_MEMO_CHUNK, POSIX_FADV_WILLNEED);
+#endif
+		}
+	}
+}
+
+/*+
+	dBase_JobRecord()
+
+	Parameters
+		`job' is a -j or -l job.
+		`rec' is one of its records, read by dBase_JobRead().
+
+	Return Values
+		Explicit
+			returns a pointer to the raw record.
+
+	History
+		ag	16 oct 26
+ +*/
+char	*dBase_JobRecord(job, rec)
+DF_JOB	*job;
+long	rec;
+{
+	DF_INFO	*d = job->src;
+
+	if (d->dbf_map != (char *)NULL)
+		return d->dbf_map + d->data_offset + (rec * (long)d->bytes);
+	return job->raw + ((rec - job->first) * (long)d->bytes);
+}
+
+/*+
+	dBase_JobConvert()
+
+	Parameters
+		`job' is a -j job.
+
+	Description
+		the first, threaded, phase of a -j conversion: convert
+		the job's dBase records, read by dBase_JobRead(), into
+		Dfile text without yet knowing which .dff blocks they
+		go in.
+		memo fields are left empty, to be filled in with their
+		block addresses by dBase_JobFormat().  deleted records
+		are kept only to be reported; records that fail the
+		-w filter are dropped.
+
+	Calls
+		Local
+			dBase_JobRecord(), dBase_Filter(), dBase_DecodeStep(),
+			dBase_MemoAddr(), dBase_JobMemo(), dBase_JobRoom(),
+			dff_TrimSpan().
+
+	Alters
+		Incoming
+			`job'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dBase_JobConvert(job)
+DF_JOB	*job;
+{
+	DF_INFO	*d = job->src;
+	long	rec;
+
+	job->num_recs = job->text_used = 0L;
+	for (rec = job->first ; rec < job->first + job->have ; rec++) {
+		DF_JOBREC	*r = &job->rec[job->num_recs];
+		DF_JOBMEMO	*m = &job->memo[job->num_recs * job->nm];
+		DF_STEP		*s, *last;
+		char		*ptr = dBase_JobRecord(job, rec),
+				*out;
+
+		r->rec = rec;
+		if (*ptr == DBASE_DELETED && FLAG_NOT_SET(d->flags.undel)) {
+			/*
+				not restoring deleted records.
+			 */
+			r->text = -1L;
+			job->num_recs++;
+			continue;
+		}
+		if (d->filter != (DF_TEST *)NULL &&
+			!dBase_Filter(d, d->filter_top, ptr))
+			continue;
+		ptr++;
+
+		if (!dBase_JobRoom(job, (long)d->num_proj * DF_FLD_SLACK +
+			(long)d->bytes))
+			return;
+		r->text = job->text_used;
+		out = job->text + r->text;
+		for (s = d->plan, last = s + d->num_proj - 1 ; s <= last ;
+			s++) {
+			char	*raw = ptr + s->off - 1;
+
+			if (s->op == DF_STEP_MEMO) {
+				/*
+					hold the memo address until the
+					record is done.
+				 */
+				m->at = (int)(out - (job->text + r->text));
+				(m++)->start = dBase_MemoAddr(d, raw, s->len);
+			} else
+				out += dBase_DecodeStep(s, raw, out);
+			if (s < last)
+				*out++ = DF_DELIM;
+		}
+		r->len = (int)(out - (job->text + r->text));
+		job->text_used += r->len;
+
+		for (m -= job->nm ; m < &job->memo[(job->num_recs + 1) *
+			job->nm] ; m++)
+			if (!dBase_JobMemo(job, m, m->start))
+				return;
+
+		if (d->split != DF_NOT_SPLIT) {
+			/*
+				keep the trimmed split field for
+				dBase_KeyPart().
+			 */
+			if (!dBase_JobRoom(job, (long)d->key.len + 2L))
+				return;
+			r->key = job->text_used;
+			r->key_len = dff_TrimSpan(ptr + d->key.off - 1,
+				d->key.len, job->text + r->key);
+			job->text_used += r->key_len + 1;
+		}
+		job->num_recs++;
+	}
+	if (rec < job->last) {
+		job->failed = DF_JOB_SHORT;
+		job->bad_rec = rec;
+	}
+}
+
+/*+
+	dBase_JobLayout()
+
+	Parameters
+		`job' is a -j job whose records are converted.
+
+	Description
+		the second phase of a -j conversion, run for each job
+		in turn: number the .dff blocks of the job's memos and
+		records, add their .dfa addresses, and find where
+		each goes in the job's blocks.  the deleted records
+		are reported, and progress shown, just as
+		dBase_ProcessRecord() would.
+
+	Calls
+		System
+			printf(), fprintf().
+		Local
+			dBase_KeyPart(), dff_UsePart(), dff_Open(),
+			dff_BlockBytes(), dff_FormatLong(), dff_WriteAddr(),
+			dff_Progress(), dff_OutOfSpace(), dff_CleanUp().
+
+	Alters
+		Incoming
+			`job', `d->cur', `d->rec_num'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dBase_JobLayout(job)
+DF_JOB	*job;
+{
+	DF_INFO	*d = job->d;
+	long	i;
+
+	job->blocks_used = 0L;
+	for (i = 0L ; i < job->num_recs ; i++) {
+		DF_JOBREC	*r = &job->rec[i];
+		DF_JOBMEMO	*m = &job->memo[i * job->nm],
+				*end = m + job->nm;
+		long		len = (long)r->len,
+				blocks;
+
+		if (r->text < 0L) {
+			if (FLAG_NOT_SET(d->flags.terse))
+				printf("\n%s: skipping %ld - use -u flag to keep\n",
+					PROGNAME, job->base + r->rec);
+			continue;
+		}
+		if (d->split != DF_NOT_SPLIT)
+			dff_UsePart(d, dBase_KeyPart(d, job->text + r->key,
+				r->key_len));
+		if (d->cur->dff.fd < 0)
+			dff_Open(d);
+		r->part = d->indx;
+		r->at = job->blocks_used;
+
+		for ( ; m < end ; m++) {
+			char	digits[24];
+
+			if (m->len < 0L) {
+				m->start = DF_FREELIST;
+				len += dff_FormatLong(digits, m->start);
+				continue;
+			}
+			m->start = d->cur->physical + 1L;
+			blocks = DF_BLOCKS(m->len);
+			job->blocks_used += dff_BlockBytes(m->start, blocks);
+			d->cur->physical += blocks;
+			len += dff_FormatLong(digits, m->start);
+		}
+
+		dff_WriteAddr(d);
+		r->start = d->cur->physical + 1L;
+		blocks = DF_BLOCKS(len);
+		job->blocks_used += dff_BlockBytes(r->start, blocks);
+		d->cur->physical += blocks;
+		r->bytes = job->blocks_used - r->at;
+		dff_Progress(d, job->base + r->rec);
+	}
+
+	if (job->failed == DF_JOB_SHORT) {
+		d->rec_num = job->base + job->bad_rec;
+		fprintf(stderr, "\n%s: record %ld not %d bytes (%ld)!\n",
+			PROGNAME, d->rec_num, d->bytes, job->bad_len);
+		dff_CleanUp(d, DF_FAILURE);
+	} else if (job->failed != DF_JOB_OK)
+		dff_OutOfSpace(d);
+}
+
+/*+
+	dBase_JobFormat()
+
+	Parameters
+		`job' is a -j job whose blocks are numbered.
+
+	Description
+		the third, threaded, phase of a -j conversion: format
+		the job's memos and records into .dff blocks, now
+		that their block addresses are known.  when
+		`job->offset' is set, the blocks are written there.
+
+	Calls
+		System
+			realloc(), memcpy().
+		Local
+			dff_FormatLong(), dff_FormatBlocks(), dff_WriteAt().
+
+	Alters
+		Incoming
+			`job'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dBase_JobFormat(job)
+DF_JOB	*job;
+{
+	long	i;
+	char	*out;
+
+	if (job->blocks_used > job->blocks_size) {
+		char	*blocks = (char *)realloc(job->blocks,
+				(size_t)job->blocks_used);
+
+		if (blocks == (char *)NULL) {
+			job->failed = DF_JOB_NOSPACE;
+			return;
+		}
+		job->blocks = blocks;
+		job->blocks_size = job->blocks_used;
+	}
+
+	for (i = 0L, out = job->blocks ; i < job->num_recs ; i++) {
+		DF_JOBREC	*r = &job->rec[i];
+		DF_JOBMEMO	*m = &job->memo[i * job->nm],
+				*end = m + job->nm;
+		char		*text,
+				*rec = job->scratch;
+		int		from = 0;
+
+		if (r->text < 0L) continue;
+		text = job->text + r->text;
+		/*
+			the memos, then the record with their
+			addresses put in.
+		 */
+		for ( ; m < end ; m++) {
+			if (m->len >= 0L)
+				out += dff_FormatBlocks(out,
+					job->text + m->text, m->len, m->start);
+			memcpy(rec, text + from, (size_t)(m->at - from));
+			rec += m->at - from;
+			rec += dff_FormatLong(rec, m->start);
+			from = m->at;
+		}
+		memcpy(rec, text + from, (size_t)(r->len - from));
+		rec += r->len - from;
+		out += dff_FormatBlocks(out, job->scratch,
+			(long)(rec - job->scratch), r->start);
+	}
+
+	if (job->offset >= 0L && job->blocks_used > 0L &&
+		dff_WriteAt(job->d->part[0].dff.fd, job->blocks,
+		job->blocks_used, job->offset) < 0L)
+		job->failed = DF_JOB_NOSPACE;
+}
+
+/*+
+	dBase_JobThread()
+
+	Parameters
+		`arg' is a -j job.
+
+	Description
+		run a phase of a -j job.  started as a thread, or
+		called directly.
+
+	Calls
+		Local
+			dBase_JobRead(), dBase_JobConvert(), dBase_JobFormat().
+
+	Return Values
+		Explicit
+			returns NULL.
+
+	History
+		ag	16 oct 26
+ +*/
+void	*dBase_JobThread(arg)
+void	*arg;
+{
+	DF_JOB	*job = (DF_JOB *)arg;
+
+	if (job->phase == DF_JOB_CONVERT) {
+		dBase_JobRead(job, 0);
+		dBase_JobConvert(job);
+	} else
+		dBase_JobFormat(job);
+	return (void *)NULL;
+}
+
+/*+
+	dBase_RunJobs()
+
+	Parameters
+		`job' are the `n' -j jobs.
+		`phase' is DF_JOB_CONVERT or DF_JOB_FORMAT.
+
+	Description
+		run a phase of every job, each in its own thread, and
+		wait for them all.  the first job runs in this thread,
+		as does any job whose thread cannot be started (or all
+		of them, without threads).
+
+	Calls
+		System
+			pthread_create(), pthread_join().
+		Local
+			dBase_JobThread().
+
+	Alters
+		Incoming
+			`job'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dBase_RunJobs(job, n, phase)
+DF_JOB	*job;
+int	n,
+	phase;
+{
+	int	i;
+#ifdef	DF_HAVE_THREADS
+	int	started[DF_MAX_JOBS];
+
+	for (i = 1 ; i < n ; i++) {
+		job[i].phase = phase;
+		started[i] = (pthread_create(&job[i].thread,
+			(pthread_attr_t *)NULL, dBase_JobThread,
+			(void *)&job[i]) == 0);
+	}
+	job[0].phase = phase;
+	(void)dBase_JobThread((void *)&job[0]);
+	for (i = 1 ; i < n ; i++)
+		if (started[i])
+			pthread_join(job[i].thread, (void **)NULL);
+		else
+			(void)dBase_JobThread((void *)&job[i]);
+#else
+	for (i = 0 ; i < n ; i++) {
+		job[i].phase = phase;
+		(void)dBase_JobThread((void *)&job[i]);
+	}
+#endif
+}
+
+/*+
+	dBase_NewJobs()
+
+	Parameters
+		`d' is the info struct.
+		`n' is the number of jobs.
+
+	Description
+		allocate `n' -j or -l jobs.  a job holds up to
+		DF_JOB_RECS records, or as many as fit in DF_JOB_BYTES.
+
+	Calls
+		System
+			malloc(), calloc().
+		Local
+			dff_OutOfSpace().
+
+	Return Values
+		Explicit
+			returns the jobs.
+
+	History
+		ag	16 oct 26
+ +*/
+DF_JOB	*dBase_NewJobs(d, n)
+DF_INFO	*d;
+int	n;
+{
+	DF_JOB	*job;
+	int	nm = 0,
+		i;
+	long	size = DF_FLD_SLACK,
+		recs = DF_JOB_BYTES / (long)d->bytes;
+
+	if (recs > DF_JOB_RECS) recs = DF_JOB_RECS;
+	if (recs < 1L) recs = 1L;
+	for (i = 0 ; i < d->num_proj ; i++) {
+		size += d->fld_len[d->proj[i]] + DF_FLD_SLACK;
+		if (d->plan[i].op == DF_STEP_MEMO) nm++;
+	}
+	if ((job = (DF_JOB *)calloc((size_t)n, sizeof(DF_JOB))) ==
+		(DF_JOB *)NULL)
+		dff_OutOfSpace(d);
+	for (i = 0 ; i < n ; i++) {
+		job[i].d = job[i].src = d;
+		job[i].nm = nm;
+		job[i].recs = recs;
+		if ((job[i].rec = (DF_JOBREC *)malloc((size_t)recs *
+			sizeof(DF_JOBREC))) == (DF_JOBREC *)NULL ||
+			(job[i].memo = (DF_JOBMEMO *)malloc((size_t)(nm + 1) *
+			(size_t)recs * sizeof(DF_JOBMEMO))) ==
+			(DF_JOBMEMO *)NULL ||
+			(d->dbf_map == (char *)NULL &&
+			(job[i].raw = (char *)malloc((size_t)(recs *
+			(long)d->bytes))) == (char *)NULL) ||
+			(job[i].stage = (char *)malloc(DF_MEMO_CHUNK)) ==
+			(char *)NULL ||
+			(job[i].scratch = (char *)malloc((size_t)size)) ==
+			(char *)NULL)
+			dff_OutOfSpace(d);
+	}
+	return job;
+}
+
+/*+
+	dBase_FreeJobs()
+
+	Parameters
+		`job' are the `n' jobs from dBase_NewJobs().
+
+	Calls
+		System
+			free().
+
+	History
+		ag	16 oct 26
+ +*/
+void	dBase_FreeJobs(job, n)
+DF_JOB	*job;
+int	n;
+{
+	int	i;
+
+	for (i = 0 ; i < n ; i++) {
+		if (job[i].text != (char *)NULL) free(job[i].text);
+		if (job[i].blocks != (char *)NULL) free(job[i].blocks);
+		if (job[i].raw != (char *)NULL) free(job[i].raw);
+		free(job[i].stage);
+		free(job[i].scratch);
+		free((char *)job[i].rec);
+		free((char *)job[i].memo);
+	}
+	free((char *)job);
+}
+
+/*+
+	dBase_JobsOut()
+
+	Parameters
+		`d' is the info struct.
+		`job' are `n' jobs whose blocks are numbered.
+
+	Description
+		format the blocks of the jobs, each in its own thread,
+		and write them.  a single database is written by the
+		threads with pwrite(), each at the offset its blocks
+		were given; split databases, and stdout, are written
+		here, in order, since they come and go from `max_open'
+		open files, or cannot be written out of order.
+
+	Calls
+		Local
+			dBase_RunJobs(), dff_IoWrite(), dff_UsePart(),
+			dff_Open(), dff_OutWrite(), dff_OutOfSpace().
+
+	Alters
+		Incoming
+			`d', `job'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dBase_JobsOut(d, job, n)
+DF_INFO	*d;
+DF_JOB	*job;
+int	n;
+{
+	long	offset = -1L;
+	int	i;
+
+	if (d->split == DF_NOT_SPLIT && d->part[0].dff.fd >= 0 &&
+		!d->part[0].dff.seq) {
+		/*
+			the blocks go after what is buffered.
+		 */
+		dff_IoWrite(d, &d->part[0].dff, DF_SUCCESS);
+		offset = d->part[0].dff.offset;
+	}
+	for (i = 0 ; i < n ; i++) {
+		job[i].offset = offset;
+		if (offset >= 0L) offset += job[i].blocks_used;
+	}
+	dBase_RunJobs(job, n, DF_JOB_FORMAT);
+	for (i = 0 ; i < n ; i++)
+		if (job[i].failed != DF_JOB_OK)
+			dff_OutOfSpace(d);
+
+	if (offset >= 0L)
+		d->part[0].dff.offset = offset;
+	else for (i = 0 ; i < n ; i++) {
+		long	r;
+
+		for (r = 0L ; r < job[i].num_recs ; r++) {
+			DF_JOBREC	*rec = &job[i].rec[r];
+
+			if (rec->text < 0L) continue;
+			dff_UsePart(d, rec->part);
+			if (d->cur->dff.fd < 0)
+				dff_Open(d);
+			dff_OutWrite(d, &d->cur->dff,
+				job[i].blocks + rec->at, (int)rec->bytes);
+		}
+	}
+}
+
+/*+
+	dBase_ConvertParallel()
+
+	Parameters
+		`d' is the info struct.
+
+	Description
+		convert all the dBase records with `d->num_jobs'
+		threads, a round of jobs at a time.  every .dff block
+		holds the address of the next, so the threads first
+		convert their records into text; the blocks are then
+		numbered in record order, as dBase_ProcessRecord()
+		would number them, and only then do the threads format
+		the blocks.  the .dff/.dfa files are byte for byte
+		those of a serial conversion.
+
+	Calls
+		Local
+			dBase_NewJobs(), dBase_RunJobs(), dBase_JobLayout(),
+			dBase_JobsOut(), dff_SaveCheckpoint(),
+			dBase_FreeJobs().
+
+	Alters
+		Incoming
+			`d'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dBase_ConvertParallel(d)
+DF_INFO	*d;
+{
+	int	n = d->num_jobs,
+		used,
+		i;
+	DF_JOB	*job = dBase_NewJobs(d, n);
+
+	for (d->rec_num = d->start_rec ; d->rec_num < d->num_records ; ) {
+		/*
+			convert a round of jobs.
+		 */
+		for (used = 0 ; used < n && d->rec_num < d->num_records ;
+			used++) {
+			job[used].first = d->rec_num;
+			if ((d->rec_num += job[used].recs) > d->num_records)
+				d->rec_num = d->num_records;
+			job[used].last = d->rec_num;
+			job[used].failed = DF_JOB_OK;
+		}
+		dBase_RunJobs(job, used, DF_JOB_CONVERT);
+
+		/*
+			number their blocks, in order.
+		 */
+		for (i = 0 ; i < used ; i++)
+			dBase_JobLayout(&job[i]);
+		dBase_JobsOut(d, job, used);
+		if (d->rec_num >= d->ckp_at)
+			dff_SaveCheckpoint(d, d->rec_num);
+	}
+	dBase_FreeJobs(job, n);
+}
+
+/*+
+	dBase_ConvertMerged()
+
+	Parameters
+		`d' is the info struct of the output, and of the first
+		-M dBase file.
+		`src' are the `n' -M dBase files, `d' first.
+
+	Description
+		convert the records of every -M file into one Dfile
+		database, file after file, with `d->num_jobs' threads.
+		as with dBase_ConvertParallel(), a round of jobs is
+		converted, numbered and then formatted; a round can
+		take records from several files, so small files are
+		converted side by side.
+
+	Calls
+		System
+			malloc().
+		Local
+			dBase_NewJobs(), dBase_RunJobs(), dBase_JobLayout(),
+			dBase_JobsOut(), dBase_FreeJobs(), dff_OutOfSpace().
+
+	Alters
+		Incoming
+			`d'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dBase_ConvertMerged(d, src, n)
+DF_INFO	*d,
+	**src;
+int	n;
+{
+	int	jobs = d->num_jobs,
+		used,
+		k = 0,
+		i;
+	long	next = 0L,		/* next record of `src[k]' */
+		base = 0L;		/* records in src[0..k-1] */
+	DF_JOB	*job = dBase_NewJobs(d, jobs);
+
+	for (i = 0 ; i < n ; i++)
+		if (src[i]->dbf_map == (char *)NULL)
+			break;
+	if (i < n)
+		/*
+			a file is read, so every job needs room for it.
+		 */
+		for (i = 0 ; i < jobs ; i++)
+			if (job[i].raw == (char *)NULL &&
+				(job[i].raw = (char *)malloc((size_t)(job[i].recs *
+				(long)d->bytes))) == (char *)NULL)
+				dff_OutOfSpace(d);
+
+	for (d->rec_num = 0L ; k < n ; ) {
+		/*
+			convert a round of jobs.
+		 */
+		for (used = 0 ; used < jobs && k < n ; ) {
+			if (next >= d->batch[k].records) {
+				base += d->batch[k++].records;
+				next = 0L;
+				continue;
+			}
+			job[used].src = src[k];
+			job[used].base = base;
+			job[used].first = next;
+			if ((next += job[used].recs) > d->batch[k].records)
+				next = d->batch[k].records;
+			job[used].last = next;
+			job[used].failed = DF_JOB_OK;
+			used++;
+		}
+		if (used == 0) break;
+		dBase_RunJobs(job, used, DF_JOB_CONVERT);
+
+		/*
+			number their blocks, in order.
+		 */
+		for (i = 0 ; i < used ; i++)
+			dBase_JobLayout(&job[i]);
+		dBase_JobsOut(d, job, used);
+		d->rec_num = base + next;
+	}
+	dBase_FreeJobs(job, jobs);
+}
+
+/*+
+	dff_RingPut()
+
+	Parameters
+		`d' is the info struct.
+		`ring' is a -l ring with one thread putting jobs in.
+		`job' is the job to put in.
+
+	Description
+		add a job to a ring, waiting while the ring is full.
+		the ring needs no lock: only the putting thread moves
+		its tail, and only the getting thread its head.
+
+	Calls
+		System
+			sched_yield().
+
+	Return Values
+		Explicit
+			returns 0 if the -l threads are stopping, otherwise 1.
+
+	History
+		ag	16 oct 26
+ +*/
+int	dff_RingPut(d, ring, job)
+DF_INFO	*d;
+DF_RING	*ring;
+DF_JOB	*job;
+{
+#ifdef	DF_HAVE_THREADS
+	unsigned	tail = ring->tail;
+
+	while (tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) ==
+		DF_RING_SIZE) {
+		if (__atomic_load_n(&d->stop, __ATOMIC_ACQUIRE)) return 0;
+		sched_yield();
+	}
+	ring->slot[tail & (DF_RING_SIZE - 1)] = job;
+	__atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+#endif
+	return 1;
+}
+
+/*+
+	dff_RingGet()
+
+	Parameters
+		`d' is the info struct.
+		`ring' is a -l ring with one thread getting jobs out.
+
+	Description
+		take the oldest job from a ring, waiting while the
+		ring is empty.
+
+	Calls
+		System
+			sched_yield().
+
+	Return Values
+		Explicit
+			returns the job, or NULL if the -l threads are
+			stopping.
+
+	History
+		ag	16 oct 26
+ +*/
+DF_JOB	*dff_RingGet(d, ring)
+DF_INFO	*d;
+DF_RING	*ring;
+{
+	DF_JOB	*job = (DF_JOB *)NULL;
+#ifdef	DF_HAVE_THREADS
+	unsigned	head = ring->head;
+
+	while (__atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == head) {
+		if (__atomic_load_n(&d->stop, __ATOMIC_ACQUIRE))
+			return (DF_JOB *)NULL;
+		sched_yield();
+	}
+	job = ring->slot[head & (DF_RING_SIZE - 1)];
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+#endif
+	return job;
+}
+
+/*+
+	dBase_ReadStage()
+
+	Parameters
+		`arg' is the -l pipe.
+
+	Description
+		the -l read thread: fill the empty jobs with the dBase
+		records, in order, and pass them on to be converted.
+
+	Calls
+		Local
+			dff_RingGet(), dff_RingPut(), dBase_JobRead().
+
+	Return Values
+		Explicit
+			returns NULL.
+
+	History
+		ag	16 oct 26
+ +*/
+void	*dBase_ReadStage(arg)
+void	*arg;
+{
+	DF_PIPE	*pipe = (DF_PIPE *)arg;
+	DF_INFO	*d = pipe->d;
+	DF_JOB	*job;
+	long	first = d->start_rec;
+
+	while (first < d->num_records &&
+		(job = dff_RingGet(d, &pipe->empty)) != (DF_JOB *)NULL) {
+		job->first = first;
+		if ((first += job->recs) > d->num_records)
+			first = d->num_records;
+		job->last = first;
+		job->failed = DF_JOB_OK;
+		dBase_JobRead(job, 1);
+		if (job->have < job->last - job->first)
+			/*
+				the records ran short; nothing
+				more to read.
+			 */
+			first = d->num_records;
+		/*
+			the job is not ours once it is passed on.
+		 */
+		if (!dff_RingPut(d, &pipe->read, job))
+			break;
+	}
+	return (void *)NULL;
+}
+
+/*+
+	dBase_ConvertStage()
+
+	Parameters
+		`arg' is the -l pipe.
+
+	Description
+		the -l convert thread: convert the records of each
+		job read, and pass it on to be written.
+
+	Calls
+		Local
+			dff_RingGet(), dff_RingPut(), dBase_JobConvert().
+
+	Return Values
+		Explicit
+			returns NULL.
+
+	History
+		ag	16 oct 26
+ +*/
+void	*dBase_ConvertStage(arg)
+void	*arg;
+{
+	DF_PIPE	*pipe = (DF_PIPE *)arg;
+	DF_INFO	*d = pipe->d;
+	DF_JOB	*job;
+	int	last = 0;
+
+	while (!last &&
+		(job = dff_RingGet(d, &pipe->read)) != (DF_JOB *)NULL) {
+		dBase_JobConvert(job);
+		last = (job->failed != DF_JOB_OK ||
+			job->last == d->num_records);
+		if (!dff_RingPut(d, &pipe->done, job))
+			break;
+	}
+	return (void *)NULL;
+}
+
+/*+
+	dBase_StopStages()
+
+	Parameters
+		`d' is the info struct.
+
+	Description
+		stop the -l threads, if running, and wait for them.
+
+	Calls
+		System
+			pthread_join().
+
+	Alters
+		Incoming
+			`d->stop', `d->num_stages'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dBase_StopStages(d)
+DF_INFO	*d;
+{
+#ifdef	DF_HAVE_THREADS
+	__atomic_store_n(&d->stop, 1, __ATOMIC_RELEASE);
+	while (d->num_stages > 0)
+		pthread_join(d->stage[--(d->num_stages)], (void **)NULL);
+#endif
+}
+
+/*+
+	dBase_ConvertPipelined()
+
+	Parameters
+		`d' is the info struct.
+
+	Description
+		convert all the dBase records in three stages, each
+		in its own thread, so reading the dBase files and
+		writing the Dfile files overlap the conversion: a
+		thread reads jobs of records (and asks for their
+		memos), another converts them, and this one numbers
+		their blocks, formats and writes them.  the stages
+		pass DF_PIPE_JOBS jobs round DF_RING_SIZE rings, in
+		record order; a stage that gets ahead waits for a job.
+		the .dff/.dfa files are those of a serial conversion.
+
+	Calls
+		System
+			pthread_create().
+		Local
+			dBase_NewJobs(), dff_RingPut(), dff_RingGet(),
+			dBase_ReadStage(), dBase_ConvertStage(),
+			dBase_JobLayout(), dBase_JobsOut(),
+			dff_SaveCheckpoint(), dBase_StopStages(),
+			dBase_FreeJobs(), dBase_ConvertParallel().
+
+	Alters
+		Incoming
+			`d'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dBase_ConvertPipelined(d)
+DF_INFO	*d;
+{
+#ifdef	DF_HAVE_THREADS
+	DF_PIPE	pipe;
+	DF_JOB	*job;
+	int	i;
+
+	if (d->start_rec >= d->num_records)
+		return;
+	memset((char *)&pipe, 0, sizeof(pipe));
+	pipe.d = d;
+	pipe.job = dBase_NewJobs(d, DF_PIPE_JOBS);
+	for (i = 0 ; i < DF_PIPE_JOBS ; i++)
+		(void)dff_RingPut(d, &pipe.empty, &pipe.job[i]);
+
+	d->stop = 0;
+	if (pthread_create(&d->stage[0], (pthread_attr_t *)NULL,
+		dBase_ReadStage, (void *)&pipe) != 0) {
+		/*
+			no threads; convert the jobs one at a time.
+		 */
+		dBase_FreeJobs(pipe.job, DF_PIPE_JOBS);
+		dBase_ConvertParallel(d);
+		return;
+	}
+	d->num_stages++;
+	if (pthread_create(&d->stage[1], (pthread_attr_t *)NULL,
+		dBase_ConvertStage, (void *)&pipe) != 0) {
+		dBase_StopStages(d);
+		dBase_FreeJobs(pipe.job, DF_PIPE_JOBS);
+		dBase_ConvertParallel(d);
+		return;
+	}
+	d->num_stages++;
+
+	/*
+		number the blocks of each job converted, and
+		write them.
+	 */
+	do {
+		job = dff_RingGet(d, &pipe.done);
+		dBase_JobLayout(job);
+		dBase_JobsOut(d, job, 1);
+		d->rec_num = job->last;
+		if (d->rec_num >= d->ckp_at)
+			dff_SaveCheckpoint(d, d->rec_num);
+	} while (job->last < d->num_records &&
+		dff_RingPut(d, &pipe.empty, job));
+
+	dBase_StopStages(d);
+	dBase_FreeJobs(pipe.job, DF_PIPE_JOBS);
+#else
+	dBase_ConvertParallel(d);
+#endif
+}
+
+/*+
+	dff_IndexAddrs()
+
+	Parameters
+		`x' is the .dfx being built.
+		`p' is some .dfa address lines.
+		`n' is the number of bytes in `p'.
+
+	Description
+		write the block of each whole line to the .dfx, and
+		mark it in the bitmap if the line starts with a `-'.
+		a line may be split over calls.
+
+	Calls
+		Local
+			dff_PutBytes().
+
+	Alters
+		Incoming
+			`x'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dff_IndexAddrs(x, p, n)
+DF_INDEX	*x;
+char	*p;
+long	n;
+{
+	for ( ; n > 0L ; n--, p++)
+		if (*p == '\n') {
+			dff_PutBytes(x->fp, x->block, DF_IDX_ADDR);
+			x->rec++;
+			x->block = 0L;
+			x->col = 0;
+		} else if (*p == '\t')
+			x->col = 1;
+		else if (x->col == 1)
+			x->block = (x->block * 10L) + (long)(*p - '0');
+		else if (*p == '-')
+			x->bits[x->rec / 8L] |= (unsigned char)(1 << (x->rec % 8L));
+}
+
+/*+
+	dff_WriteIndex()
+
+	Parameters
+		`d' is the info struct.
+		`tmp_file' is the .dft, if the addresses were moved there.
+
+	Description
+		-x: write the .dfx, a binary copy of the .dfa that
+		can be mapped into memory and used without parsing.
+		all numbers are little-endian:
+			bytes 0-2	"DFX"
+			byte 3		DF_IDX_VERSION
+			bytes 4-7	DF_IDX_HEAD, the header bytes
+			bytes 8-15	N, the number of records
+			bytes 16-23	where the bitmap starts,
+					DF_IDX_HEAD + 8 * N
+			bytes 24-27	DF_BLOCK_LEN
+			bytes 28-31	0
+		then the .dff block of each record, 8 bytes each
+		(a record starts at byte DF_BLOCK_LEN * its block of
+		the .dff), then N bits, 8 to a byte and low
+		bit first, set for each protected record.
+		never gzip'd.
+
+	Calls
+		System
+			fopen(), fwrite(), putc(), fclose(), open(),
+			read(), close(), malloc(), memset(), free().
+		Local
+			dff_GenDfilename(), dff_OutOfSpace(), dff_PutBytes(),
+			dff_IndexAddrs(), CheckDiskSpace().
+
+	History
+		ag	16 oct 26
+ +*/
+void	dff_WriteIndex(d, tmp_file)
+DF_INFO	*d;
+char	*tmp_file;
+{
+	DF_ADDRS	*a = &d->cur->addrs;
+	DF_INDEX	x;
+	long	bytes = (d->cur->logical + 7L) / 8L,
+		n;
+	char	*buffer;
+	int	in;
+
+	if ((x.fp = fopen(dff_GenDfilename(d, DF_IDX_EXT), "wb")) ==
+		(FILE *)NULL)
+		dff_OutOfSpace(d);
+	if ((x.bits = (unsigned char *)malloc((size_t)bytes + 1)) ==
+		(unsigned char *)NULL)
+		dff_OutOfSpace(d);
+	memset((char *)x.bits, 0, (size_t)bytes + 1);
+	x.rec = x.block = 0L;
+	x.col = 0;
+
+	fwrite(DF_IDX_MAGIC, 1, strlen(DF_IDX_MAGIC), x.fp);
+	(void)putc(DF_IDX_VERSION, x.fp);
+	dff_PutBytes(x.fp, (long)DF_IDX_HEAD, 4);
+	dff_PutBytes(x.fp, d->cur->logical, 8);
+	dff_PutBytes(x.fp, DF_IDX_HEAD + (d->cur->logical * DF_IDX_ADDR), 8);
+	dff_PutBytes(x.fp, (long)DF_BLOCK_LEN, 4);
+	dff_PutBytes(x.fp, 0L, 4);
+
+	if (a->spilled) {
+		if ((buffer = (char *)malloc(DF_OUT_BUFSIZE)) == (char *)NULL)
+			dff_OutOfSpace(d);
+		if ((in = open(tmp_file, O_RDONLY)) < 0) dff_OutOfSpace(d);
+		while ((n = (long)read(in, buffer, DF_OUT_BUFSIZE)) > 0L)
+			dff_IndexAddrs(&x, buffer, n);
+		close(in);
+		free(buffer);
+		if (n < 0L) dff_OutOfSpace(d);
+	} else
+		dff_IndexAddrs(&x, a->text, a->used);
+
+	fwrite((char *)x.bits, 1, (size_t)bytes, x.fp);
+	free(x.bits);
+	CheckDiskSpace(d, x.fp);
+	fclose(x.fp);
+}
+
+/*+
+	dff_DFTtoDFA()
+
+	Parameters
+		`d' is the info struct.
+		`status' is DF_SUCCESS or DF_FAILURE.
+
+	Description
+		creates the .dfa file from the addresses held in memory,
+		or from the .dft temp file they were moved to.  -A
+		names a descriptor to write it to instead.  with -z
+		it is gzip'd by a helper thread.
+		-x writes the .dfx from them as well.
+
+	Calls
+		System
+			strcpy(), printf(), fprintf(), open(), fdopen(),
+			fclose(), fwrite(), unlink(), truncate(), free().
+		Local
+			dff_GenDfilename(), dff_OutOfSpace(), dff_CopyFile(),
+			dff_ZipOpen(), dff_ZipEnd(), dff_WriteIndex(),
+			CheckDiskSpace().
+
+	Return Values
+		Explicit
+			returns the number of records in the .dfa file.
+
+	History
+		dw	15 dec 92
+ +*/
+long	dff_DFTtoDFA(d, status)
+DF_INFO	*d;
+int	status;
+{
+	char		adr_file[DF_NAME_LEN],
+			tmp_file[DF_NAME_LEN];
+	DF_ADDRS	*a = &d->cur->addrs;
+
+	strcpy(adr_file, dff_GenDfilename(d, DF_ADR_EXT));
+	strcpy(tmp_file, dff_GenDfilename(d, DF_TMP_EXT));
+	
+	if (status == DF_SUCCESS && FLAG_NOT_SET(d->flags.terse))
+		printf("%s has %ld records\n",
+			dff_GenDfilename(d, DF_DF_EXT), d->cur->logical);
+
+	if (status == DF_SUCCESS &&
+		(d->cur->logical > 0L || d->dfa_fd >= 0)) {
+		/*
+			add the number of records to the top of the .dfa file.
+			-A writes it to a descriptor, even with no records.
+		 */
+		int	fd = (d->dfa_fd >= 0 ? d->dfa_fd : open(adr_file,
+				O_WRONLY | O_CREAT | O_TRUNC, 0666));
+		FILE	*tmp;
+#ifdef	DF_HAVE_ZLIB
+		DF_ZIP	zip;
+
+		if (fd >= 0 && FLAG_SET(d->flags.zip))
+			fd = dff_ZipOpen(d, &zip, fd, 1);
+#endif
+		if (fd < 0 || (tmp = fdopen(fd, "w")) == (FILE *)NULL)
+			dff_OutOfSpace(d);
+		Dfile_WriteComment(tmp, "Dfile Version");
+		fprintf(tmp, "char\tVersion\t{%s}\n", DF_VERSION_STRING);
+		Dfile_WriteComment(tmp, "Dfile Model name");
+		fprintf(tmp, "char\tModel\t{%s}\n", d->model);
+		fprintf(tmp, "char\tFileProtected\t{%s}\n",
+			(FLAG_SET(d->flags.protect_file) ? "yes" : "no"));
+		fprintf(tmp, "long\tNumRecords\t%ld\n", d->cur->logical);
+		Dfile_WriteComment(tmp, "a `-' marks a record as protected");
+		fprintf(tmp, "long\tRecordAddresses[%ld]\n",
+			d->cur->logical * 2L);
+		if (a->spilled)
+			dff_CopyFile(d, tmp, tmp_file);
+		else if (a->used > 0L)
+			fwrite(a->text, 1, (size_t)a->used, tmp);
+		CheckDiskSpace(d, tmp);
+		fclose(tmp);
+#ifdef	DF_HAVE_ZLIB
+		if (FLAG_SET(d->flags.zip) && dff_ZipEnd(&zip))
+			dff_OutOfSpace(d);
+#endif
+		if (FLAG_SET(d->flags.index))
+			dff_WriteIndex(d, tmp_file);
+		unlink(tmp_file);
+	} else if (status == DF_FAILURE && d->saved_rec > 0L) {
+		/*
+			leave them for -r, which cuts them back to
+			the -c checkpoint.
+		 */
+	} else if (FLAG_SET(d->flags.dff_pipe)) {
+		/*
+			the .dff went to stdout; nothing to remove.
+		 */
+	} else {
+		/*
+			exiting with DF_FAILURE status or
+			no records for this letter;
+			remove all associated Dfile files.
+		 */
+		unlink(tmp_file);
+#ifdef	DF_HAVE_MMAP
+		if (d->cur->kept > 0L)
+			/*
+				back to what the -i checkpoint has.
+			 */
+			(void)truncate(dff_GenDfilename(d, DF_DF_EXT),
+				(off_t)d->cur->kept);
+		else
+#endif
+		{
+			unlink(dff_GenDfilename(d, DF_DF_EXT));
+			if (FLAG_SET(d->flags.index))
+				unlink(dff_GenDfilename(d, DF_IDX_EXT));
+		}
+	}
+	if (a->text != (char *)NULL) free(a->text);
+	d->addr_held -= a->size;
+	a->text = (char *)NULL;
+	a->used = a->size = 0L;
+	a->spilled = 0;
+
+	return d->cur->logical;
+}
+
+/*+
+	dBase_Fingerprint()
+
+	Parameters
+		`d' is the info struct, after dBase_Init().
+
+	Description
+		hash the .dbf header, less the date and record count
+		that change as records are added, with the flags that
+		decide what the Dfile files hold and any -k rN ranges.
+		a checkpoint is only used by a conversion with the
+		same fingerprint.
+
+	Calls
+		System
+			malloc(), free(), sprintf().
+		Local
+			dBase_ReadAt(), dff_OutOfSpace().
+
+	Return Values
+		Explicit
+			returns the fingerprint.
+
+	History
+		ag	16 oct 26
+ +*/
+unsigned long	dBase_Fingerprint(d)
+DF_INFO	*d;
+{
+	unsigned long	h = 2166136261UL;
+	char		*head,
+			flags[64];
+	int		n,
+			i;
+
+	if ((head = (char *)malloc((size_t)d->data_offset)) == (char *)NULL)
+		dff_OutOfSpace(d);
+	n = dBase_ReadAt(d->dbf, head, d->data_offset, 0L);
+	for (i = 0 ; i < n ; i++)
+		if (i == 0 || i >= 8)
+			h = ((h ^ (unsigned long)(head[i] & 0xff)) *
+				16777619UL) & 0xffffffffUL;
+	free(head);
+
+	sprintf(flags, "%d %d %d %d %d", d->split, d->key_how, d->key_arg,
+		(int)d->flags.undel, (int)d->flags.protect_recs);
+	for (i = 0 ; i < 4 ; i++) {
+		char	*p = (i == 0 ? flags : i == 1 ? d->model :
+				i == 2 ? d->fields : d->where);
+
+		for ( ; p != (char *)NULL && *p ; p++)
+			h = ((h ^ (unsigned long)(*p & 0xff)) *
+				16777619UL) & 0xffffffffUL;
+		h = ((h ^ 0xffUL) * 16777619UL) & 0xffffffffUL;
+	}
+	for (i = 0 ; i < d->num_bounds ; i++) {
+		char	*p;
+
+		for (p = d->bound[i].text ; *p ; p++)
+			h = ((h ^ (unsigned long)(*p & 0xff)) *
+				16777619UL) & 0xffffffffUL;
+		h = ((h ^ 0xffUL) * 16777619UL) & 0xffffffffUL;
+	}
+	return h;
+}
+
+/*+
+	dff_WriteCheckpoint()
+
+	Parameters
+		`d' is the info struct.
+		`done' is the number of dBase records converted.
+		`finished' is non-zero once the .dfa files are
+			written.
+
+	Description
+		write the checkpoint, `out_file'.dfc: the dBase
+		records converted, the dBase_Fingerprint(), whether
+		the conversion finished, and for each output Dfile
+		database, its last record, last block, and .dff and
+		.dft bytes.  it is written under another name and
+		renamed, so a failure part way leaves the last one.
+
+	Calls
+		System
+			fopen(), fprintf(), fflush(), fsync(), fclose(),
+			stat(), strcpy(), rename().
+		Local
+			dff_FileAndExt(), dff_GenDfilename(),
+			Dfile_WriteComment(), dff_OutOfSpace(),
+			CheckDiskSpace().
+
+	History
+		ag	16 oct 26
+ +*/
+void	dff_WriteCheckpoint(d, done, finished)
+DF_INFO	*d;
+long	done;
+int	finished;
+{
+	FILE	*fp;
+	char	new_file[DF_NAME_LEN];
+	int	indx = d->indx,
+		i;
+
+	strcpy(new_file, dff_FileAndExt(d, d->out_file, DF_CKP_NEW_EXT));
+	if ((fp = fopen(new_file, "w")) == (FILE *)NULL)
+		dff_OutOfSpace(d);
+	Dfile_WriteComment(fp, "Dfile Version");
+	fprintf(fp, "char\tVersion\t{%s}\n", DF_VERSION_STRING);
+	Dfile_WriteComment(fp, "Dfile Model name");
+	fprintf(fp, "char\tModel\t{%s}\n", d->model);
+	Dfile_WriteComment(fp,
+		"dBase records converted, and the dBase file they came from");
+	fprintf(fp, "long\tRecords\t%ld\n", done);
+	fprintf(fp, "long\tNumRecords\t%ld\n", d->num_records);
+	fprintf(fp, "char\tFingerprint\t{%08lx}\n", d->fingerprint);
+	fprintf(fp, "char\tFinished\t{%s}\n", (finished ? "yes" : "no"));
+	fprintf(fp, "int\tNumParts\t%d\n", d->num_parts);
+	Dfile_WriteComment(fp,
+		"file ({} if not split), last record, last block, .dff and .dft bytes");
+	fprintf(fp, "char\tParts[NumParts][5]\n");
+	for (i = 0 ; i < d->num_parts ; i++) {
+		long	bytes = 0L,
+			tmp_bytes = 0L;
+#ifdef	DF_HAVE_MMAP
+		struct stat	st;
+
+		d->indx = i;
+		if (d->part[i].logical > 0L &&
+			stat(dff_GenDfilename(d, DF_DF_EXT), &st) == 0)
+			bytes = (long)st.st_size;
+		if (!finished && d->part[i].addrs.spilled &&
+			stat(dff_GenDfilename(d, DF_TMP_EXT), &st) == 0)
+			tmp_bytes = (long)st.st_size;
+#endif
+		fprintf(fp, "{%s}\t%ld\t%ld\t%ld\t%ld\n",
+			(d->part[i].name != (char *)NULL ? d->part[i].name : ""),
+			d->part[i].logical, d->part[i].physical, bytes,
+			tmp_bytes);
+	}
+	d->indx = indx;
+	CheckDiskSpace(d, fp);
+#ifdef	DF_HAVE_MMAP
+	if (fflush(fp) != 0 || fsync(fileno(fp)) != 0)
+		dff_OutOfSpace(d);
+#endif
+	fclose(fp);
+	if (rename(new_file, dff_FileAndExt(d, d->out_file, DF_CKP_EXT)) != 0)
+		dff_OutOfSpace(d);
+}
+
+/*+
+	dff_SaveCheckpoint()
+
+	Parameters
+		`d' is the info struct.
+		`done' is the number of dBase records converted, all
+			of them handed to the outputs.
+
+	Description
+		the -c checkpoint: write what the outputs hold, wait
+		for the writes, sync the open .dff and .dft files to
+		disk, then write the checkpoint.  a conversion that
+		fails after this leaves its files for -r, which
+		cuts them back to the checkpoint and converts from
+		record `done' on.  the .dfa addresses are kept in
+		the .dft files while checkpointing, so they are on
+		disk too.
+
+	Calls
+		System
+			fsync().
+		Local
+			dff_IoWrite(), dff_IoWait(), dff_WriteCheckpoint(),
+			dff_OutOfSpace().
+
+	Alters
+		Incoming
+			`d->saved_rec', `d->ckp_at'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dff_SaveCheckpoint(d, done)
+DF_INFO	*d;
+long	done;
+{
+	int	i;
+
+	for (i = 0 ; i < d->num_parts ; i++) {
+		if (d->part[i].dff.fd >= 0)
+			dff_IoWrite(d, &d->part[i].dff, DF_SUCCESS);
+		if (d->part[i].dfa.fd >= 0)
+			dff_IoWrite(d, &d->part[i].dfa, DF_SUCCESS);
+	}
+	dff_IoWait(d, 1, DF_SUCCESS);
+#ifdef	DF_HAVE_MMAP
+	for (i = 0 ; i < d->num_parts ; i++)
+		if ((d->part[i].dff.fd >= 0 && fsync(d->part[i].dff.fd) != 0) ||
+			(d->part[i].dfa.fd >= 0 &&
+			fsync(d->part[i].dfa.fd) != 0))
+			dff_OutOfSpace(d);
+#endif
+	dff_WriteCheckpoint(d, done, 0);
+	d->saved_rec = done;
+	d->ckp_at = done + d->ckp_recs;
+}
+
+/*+
+	dff_ReadCheckpoint()
+
+	Parameters
+		`d' is the info struct, after dBase_Init() and
+		dff_IoInit().
+
+	Description
+		pick up an -i conversion where the last one ended,
+		or a -c conversion that failed where its last
+		checkpoint was written (-r): if `out_file'.dfc
+		matches the dBase file and every .dff is as it left
+		them, the records it converted are skipped, and the
+		others are added to the .dff files.
+		for -i, the .dfa addresses already written are read
+		back, to be written again with the new ones.  for
+		-r, the .dff and .dft files are cut back to the
+		checkpoint, and the .dft files added to.
+		anything amiss, and every record is converted.
+
+	Calls
+		System
+			fopen(), fgets(), sscanf(), fclose(), stat(),
+			truncate(), malloc(), free(), fread(), fseek(),
+			strcmp(), printf().
+		Local
+			dff_FileAndExt(), dff_GenDfilename(),
+			dBase_Fingerprint(), dff_FindPart(), dff_AddrWrite(),
+			dff_OutOfSpace().
+
+	Alters
+		Incoming
+			`d->part', `d->start_rec', `d->saved_rec',
+			`d->fingerprint'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dff_ReadCheckpoint(d)
+DF_INFO	*d;
+{
+	FILE		*fp;
+	char		line[DF_NAME_LEN],
+			finished[4],
+			*why = (char *)NULL;
+	long		records = -1L,
+			num_records = -1L,
+			(*count)[4] = (long (*)[4])NULL;
+	unsigned long	print = 0UL;
+	int		num_parts = -1,
+			*indx = (int *)NULL,
+			resume,
+			n = 0,
+			got,
+			i;
+
+	d->fingerprint = dBase_Fingerprint(d);
+	if ((fp = fopen(dff_FileAndExt(d, d->out_file, DF_CKP_EXT), "r")) ==
+		(FILE *)NULL)
+		return;
+	strcpy(finished, "yes");
+	while (fgets(line, sizeof(line), fp) != (char *)NULL && why == NULL) {
+		char	name[DF_NAME_LEN];
+
+		if (line[0] == '#' || sscanf(line, "long\tRecords\t%ld",
+			&records) == 1 || sscanf(line,
+			"long\tNumRecords\t%ld", &num_records) == 1 ||
+			sscanf(line, "char\tFingerprint\t{%lx}", &print) == 1 ||
+			sscanf(line, "char\tFinished\t{%3[^}]}",
+			finished) == 1 || strncmp(line, "char\t", 5) == 0)
+			continue;
+		if (sscanf(line, "int\tNumParts\t%d", &num_parts) == 1) {
+			if (num_parts < 1 ||
+				(indx = (int *)malloc(sizeof(int) *
+				num_parts)) == (int *)NULL ||
+				(count = (long (*)[4])malloc(sizeof(long) * 4 *
+				num_parts)) == (long (*)[4])NULL)
+				why = "bad parts";
+			continue;
+		}
+		if (indx != (int *)NULL && n < num_parts)
+			count[n][3] = 0L;
+		if (indx == (int *)NULL || n >= num_parts || line[0] != '{' ||
+			(line[1] == '}' ? (name[0] = '\0',
+			sscanf(line, "{}\t%ld\t%ld\t%ld\t%ld", &count[n][0],
+			&count[n][1], &count[n][2], &count[n][3]) < 3) :
+			sscanf(line, "{%[^}]}\t%ld\t%ld\t%ld\t%ld", name,
+			&count[n][0], &count[n][1], &count[n][2],
+			&count[n][3]) < 4)) {
+			why = "unreadable";
+			continue;
+		}
+		if ((name[0] == '\0') != (d->split == DF_NOT_SPLIT))
+			why = "split differently";
+		else
+			indx[n++] = (name[0] == '\0' ? 0 : dff_FindPart(d, name));
+	}
+	fclose(fp);
+
+	/*
+		a checkpoint that did not finish is one a -c
+		conversion wrote on the way.
+	 */
+	resume = (strcmp(finished, "yes") != 0);
+	if (why == (char *)NULL) {
+		if (n != num_parts || records < 0L)
+			why = "unreadable";
+		else if (print != d->fingerprint)
+			why = "dBase file or flags changed";
+		else if (records > d->num_records)
+			why = "dBase file has fewer records";
+		else if (!resume && FLAG_NOT_SET(d->flags.incremental))
+			why = "its conversion finished";
+		else if (resume && FLAG_NOT_SET(d->flags.resume))
+			why = "its conversion did not finish; use -r";
+		else if (resume && num_records != d->num_records)
+			why = "dBase file changed";
+	}
+#ifdef	DF_HAVE_MMAP
+	for (i = 0 ; i < n && why == (char *)NULL ; i++) {
+		struct stat	st;
+
+		d->indx = indx[i];
+		if (count[i][0] > 0L &&
+			(stat(dff_GenDfilename(d, DF_DF_EXT), &st) != 0 ||
+			(resume ? (long)st.st_size < count[i][2] :
+			(long)st.st_size != count[i][2]) ||
+			stat(dff_GenDfilename(d, (resume ? DF_TMP_EXT :
+			DF_ADR_EXT)), &st) != 0 ||
+			(resume && (long)st.st_size < count[i][3])))
+			why = "Dfile files changed";
+	}
+#else
+	why = "not supported";
+#endif
+
+	if (why == (char *)NULL && resume)
+		/*
+			from here on, a failure leaves the files
+			for -r again.
+		 */
+		d->saved_rec = records;
+	if (why != (char *)NULL) {
+		if (FLAG_NOT_SET(d->flags.terse))
+			printf("%s: %s.%s not used (%s); converting every record\n",
+				PROGNAME, d->out_file, DF_CKP_EXT, why);
+	} else for (i = 0 ; i < n ; i++) {
+		/*
+			the parts as the checkpoint left them, with
+			their .dfa addresses.
+		 */
+		DF_PART	*part = &d->part[indx[i]];
+		int	skip = 1;
+
+		part->logical = count[i][0];
+		part->physical = count[i][1];
+		part->kept = count[i][2];
+		if (part->logical == 0L) continue;
+		d->cur = &d->part[d->indx = indx[i]];
+#ifdef	DF_HAVE_MMAP
+		if (resume) {
+			/*
+				cut back what was written after the
+				checkpoint; the addresses stay in the
+				.dft file.
+			 */
+			if (truncate(dff_GenDfilename(d, DF_DF_EXT),
+				(off_t)count[i][2]) != 0 ||
+				truncate(dff_GenDfilename(d, DF_TMP_EXT),
+				(off_t)count[i][3]) != 0)
+				dff_OutOfSpace(d);
+			part->addrs.spilled = 1;
+			continue;
+		}
+#endif
+		if ((fp = fopen(dff_GenDfilename(d, DF_ADR_EXT), "r")) ==
+			(FILE *)NULL)
+			dff_OutOfSpace(d);
+		while (skip && fgets(line, sizeof(line), fp) != (char *)NULL)
+			skip = (strncmp(line, "long\tRecordAddresses[", 21) != 0);
+		while ((got = (int)fread(line, 1, sizeof(line), fp)) > 0)
+			dff_AddrWrite(d, line, got);
+		fclose(fp);
+	}
+	if (indx != (int *)NULL) free((char *)indx);
+	if (count != (long (*)[4])NULL) free((char *)count);
+	d->cur = &d->part[d->indx = 0];
+	if (why != (char *)NULL) return;
+
+	d->start_rec = records;
+	d->percent_done = (int)((records + d->report - 1) / d->report);
+	if (d->dbf_map == (char *)NULL)
+		fseek(d->dbf, d->data_offset + (records * (long)d->bytes), 0);
+	if (FLAG_NOT_SET(d->flags.terse))
+		printf("%ld records converted before; %ld to convert\n",
+			records, d->num_records - records);
+}
+
+/*+
+	dff_Init()
+
+	Parameters
+		`d' is the info struct.
+
+	Description
+		initialises the Dfile info struct.
+
+	Calls
+		Local
+			dff_TrimInit().
+
+	Alters
+		Incoming
+			`d'.
+
+	History
+		dw	15 dec 92
+ +*/
+void	dff_Init(d)
+DF_INFO	*d;
+{
+	/*
+		initialise stuff
+	 */
+	d->out_dir = d->model = d->in_file = d->fields = d->fld_name =
+		d->where =
+		d->out_file = d->fld_buffer = d->rec_buffer =
+		d->out_buffer = d->memo_buffer =
+		d->dbf_map = d->dbt_map = d->peek_buffer = d->dbf_head =
+		(char *)NULL;
+	d->memo_fd = d->dfa_fd = -1;
+	d->cache = (DF_CACHE *)NULL;
+	d->plan = (DF_STEP *)NULL;
+	d->filter = (DF_TEST *)NULL;
+	d->memo_off = d->proj = (int *)NULL;
+	d->num_memo = d->percent_done = 0;
+	d->num_jobs = 1;
+	d->num_stages = d->stop = 0;
+	d->split = DF_NOT_SPLIT;
+	dff_TrimInit();
+	d->indx = d->block_used = 0;
+	d->flags.help = d->flags.headers =
+		d->flags.protect_recs = d->flags.protect_file =
+		d->flags.undel = d->flags.pipeline = d->flags.batch =
+		d->flags.merge = d->flags.incremental = d->flags.resume =
+		d->flags.dbf_pipe = d->flags.dff_pipe = d->flags.memo_spool =
+		d->flags.zip = d->flags.index = d->flags.terse = (unsigned)0;
+	d->hlp = d->dfh = d->dfw = d->dbf = d->dbf_in = d->dbt = (FILE *)NULL;
+#ifdef	DF_HAVE_IO_URING
+	d->io = (DF_IO *)NULL;
+#endif
+#ifdef	DF_HAVE_ZLIB
+	d->dbf_zip = (DF_ZIP *)NULL;
+#endif
+	d->rec_num = d->num_records = d->start_rec = 0L;
+	d->ckp_recs = d->ckp_at = d->saved_rec = 0L;
+	d->fingerprint = 0UL;
+	d->data_offset = d->dbf_map_len = d->dbt_map_len = d->advised =
+		d->prefetched = 0L;
+	d->addr_held = 0L;
+	d->addr_limit = DF_ADDR_LIMIT * 1024L * 1024L;
+	d->cur = (DF_PART *)NULL;
+	d->part = (DF_PART *)NULL;
+	d->part_hash = (int *)NULL;
+	d->num_parts = d->max_parts = d->hash_size = d->num_open = 0;
+	d->max_open = DF_MAX_OPEN;
+	d->newest = d->oldest = -1;
+	d->key_how = DF_KEY_LETTER;
+	d->key_arg = 0;
+	d->bound = (DF_BOUND *)NULL;
+	d->num_bounds = 0;
+	d->fld_dec = d->fld_type = d->fld_len = (int *)NULL;
+	d->batch = (DF_BATCH *)NULL;
+	d->num_batch = d->max_batch = 0;
+	d->converted = 0L;
+	d->bail = (jmp_buf *)NULL;
+}
+
+static char *use[] = {
+	"usage: dbf2dff [-bghilMpPrutxz -s # -k key -o file -m name -f fields -w test -a # -j # -c # -D fd -A fd] file ...",
+	"flags:",
+	"g; generate Dfile header file during conversion",
+	"h; generate Dfile help file template during conversion",
+	"p; mark records as \"protected\" from editing via Dfile",
+	"P; mark files as \"protected\" from editing via Dfile",
+	"u; undelete dBase records during conversion (default: leave them out)",
+	"s #; split into files based on field #",
+	"k key; split by prefix pN, hash hN, bucket bN or range rN of the split field",
+	"o file; name an output file",
+	"m model; give a name to a family of converted files",
+	"f fields; convert only these fields (names or #s, comma-separated)",
+	"w test; convert only records passing test, e.g. \"CODE=NE & QTY>5\"",
+	"a #; hold up to # Mbytes of record addresses in memory",
+	"j #; convert with # threads (0: one per processor)",
+	"l; read, convert and write in a pipeline of 3 threads",
+	"b; convert each file, directory or @list named, largest first",
+	"M; merge the files named, in order, into one Dfile database",
+	"i; convert only records added since the last -i run (.dfc checkpoint)",
+	"c #; checkpoint every # records, so a failed conversion can be resumed",
+	"r; resume a -c conversion from its last checkpoint",
+	"D fd; read the memo file from open descriptor fd",
+	"A fd; write the .dfa file to open descriptor fd",
+	"-; read the dBase file from stdin (-o -: the .dff to stdout)",
+	"z; gzip the .dff and .dfa files (gzip'd dBase files are always read)",
+	"x; also write the .dfa addresses in binary, as a .dfx file",
+	"t; terse/silent conversion",
+	(char *)NULL
+};
+
+/*+
+	dff_Usage()
+
+	Description
+		called when bad command-line args are used.
+		show em what is valid. exits with code DF_FAILURE.
+
+	Calls
+		System
+			fprintf(), fputc(), exit().
+
+	History
+		dw	15 dec 92
+ +*/
+void	dff_Usage()
+{
+	int	i = 0;
+	while (use[i] != (char *)NULL) fprintf(stderr, "%s\n\t", use[i++]);
+	fputc('\n', stderr);
+	exit(DF_FAILURE);
+}
+
+/*+
+	dff_DecodeArgs()
+
+	Parameters
+		`d' is the info struct.
+		`argc' is the number of command-line arguments.
+		`argv' are the command line args.
+
+	Description
+		set the appropriate flags and values in `d' as
+		specified by the user.  call dff_Usage() if invalid
+		command line is encountered.
+
+	Calls
+		System
+			strlen(), strcmp(), fprintf(), atoi(), atol(),
+			sysconf(), printf(), malloc(), free().
+		Local
+			dff_Usage(), dff_BatchExpand(), dff_OutOfSpace().
+
+	Alters
+		Incoming
+			`d'.
+
+	History
+		dw	15 dec 92
+ +*/
+void	dff_DecodeArgs(d, argc, argv)
+DF_INFO	*d;
+int	argc;
+char	*argv[];
+{
+	int	i,
+		num_names = 0;
+	char	**names;
+
+	if (argc < 2) dff_Usage();
+	if ((names = (char **)malloc(sizeof(char *) * argc)) ==
+		(char **)NULL)
+		dff_OutOfSpace(d);
+
+	/*
+		process the command line arguments.
+		they can come in any order and can be concatenated.
+	 */
+	for (i = 1 ; i < argc ; i++)
+		if (argv[i][0] == '-' && argv[i][1] != '\0') {
+			int	opt_len, opt_indx = 0;
 			opt_len = strlen(&argv[i][1]);
 			while (opt_len-- > 0) {
 				int	opt = argv[i][++opt_indx];
@@ -1126,6 +7925,14 @@ char	*argv[];
 					case 's':
 					case 'o':
 					case 'm':
+					case 'f':
+					case 'w':
+					case 'a':
+					case 'k':
+					case 'j':
+					case 'c':
+					case 'D':
+					case 'A':
 					if (i == argc - 1) {
 						fprintf(stderr,
 					"%s: expected a value for flag `%c'\n",
@@ -1145,6 +7952,69 @@ char	*argv[];
 					d->out_file = argv[++i];
 				else if (opt == 'm')
 					d->model = argv[++i];
+				else if (opt == 'f')
+					d->fields = argv[++i];
+				else if (opt == 'w')
+					d->where = argv[++i];
+				else if (opt == 'a')
+					d->addr_limit = atol(argv[++i]) *
+						1024L * 1024L;
+				else if (opt == 'j') {
+					d->num_jobs = atoi(argv[++i]);
+#if defined(DF_HAVE_THREADS) && defined(_SC_NPROCESSORS_ONLN)
+					if (d->num_jobs == 0)
+						/*
+							one per processor.
+						 */
+						d->num_jobs = (int)sysconf(
+							_SC_NPROCESSORS_ONLN);
+#endif
+					if (d->num_jobs < 1)
+						d->num_jobs = 1;
+					else if (d->num_jobs > DF_MAX_JOBS)
+						d->num_jobs = DF_MAX_JOBS;
+				}
+				else if (opt == 'c') {
+					if ((d->ckp_recs = atol(argv[++i])) <=
+						0L) {
+						fprintf(stderr,
+					"%s: bad checkpoint interval `%s'\n",
+							PROGNAME, argv[i]);
+						dff_Usage();
+					}
+				}
+				else if (opt == 'D' || opt == 'A') {
+					int	fd = atoi(argv[++i]);
+
+					if (fd < 0 || argv[i][0] < '0' ||
+						argv[i][0] > '9') {
+						fprintf(stderr,
+					"%s: bad file descriptor `%s'\n",
+							PROGNAME, argv[i]);
+						dff_Usage();
+					}
+					if (opt == 'D')
+						d->memo_fd = fd;
+					else
+						d->dfa_fd = fd;
+				}
+				else if (opt == 'k') {
+					char	*key = argv[++i];
+
+					d->key_how = key[0];
+					if ((d->key_how != DF_KEY_PREFIX &&
+						d->key_how != DF_KEY_HASH &&
+						d->key_how != DF_KEY_BUCKET &&
+						d->key_how != DF_KEY_RANGE) ||
+						(d->key_arg = atoi(&key[1])) <= 0 ||
+						(d->key_how == DF_KEY_PREFIX &&
+						d->key_arg > DF_KEY_LEN)) {
+						fprintf(stderr,
+						"%s: bad split key `%s'\n",
+							PROGNAME, key);
+						dff_Usage();
+					}
+				}
 				else if (opt == 'g')
 					d->flags.headers = (unsigned)1;
 				else if (opt == 'p')
@@ -1157,492 +8027,1976 @@ char	*argv[];
 					d->flags.undel = (unsigned)1;
 				else if (opt == 't')
 					d->flags.terse = (unsigned)1;
+				else if (opt == 'l')
+					d->flags.pipeline = (unsigned)1;
+				else if (opt == 'b')
+					d->flags.batch = (unsigned)1;
+				else if (opt == 'M')
+					d->flags.merge = (unsigned)1;
+				else if (opt == 'i')
+					d->flags.incremental = (unsigned)1;
+				else if (opt == 'r')
+					d->flags.resume = (unsigned)1;
+				else if (opt == 'x')
+					d->flags.index = (unsigned)1;
+				else if (opt == 'z') {
+#ifdef	DF_HAVE_ZLIB
+					d->flags.zip = (unsigned)1;
+#else
+					fprintf(stderr,
+				"%s: -z needs a build with DF_USE_ZLIB\n",
+						PROGNAME);
+					dff_Usage();
+#endif
+				}
 				else {
 					fprintf(stderr, "%s: bad flag `%c'\n", 
 						PROGNAME, opt);
 					dff_Usage();
 				}
 			}
-		} else {
+		} else {
+			/*
+				set the dBase filename.  without -b or
+				-M the last free-standing argument found
+				will be the input file used.  with them
+				every name is kept; directories and
+				quoted wildcards are expanded to their
+				*.dbf and *.DBF files below, by
+				dff_BatchExpand().  `-' is stdin.
+			 */
+			if (d->in_file != (char *)NULL &&
+				FLAG_NOT_SET(d->flags.batch) &&
+				FLAG_NOT_SET(d->flags.merge))
+				printf("%s: ignoring previous dBase file: %s\n",
+					PROGNAME, d->in_file);
+			d->in_file = names[num_names++] = argv[i];
+		}
+	if (FLAG_SET(d->flags.resume) && d->ckp_recs == 0L)
+		/*
+			-r goes on checkpointing.
+		 */
+		d->ckp_recs = DF_CKP_RECS;
+
+	if (FLAG_SET(d->flags.batch) && FLAG_SET(d->flags.merge)) {
+		fprintf(stderr, "%s: -b and -M cannot be used together\n",
+			PROGNAME);
+		dff_Usage();
+	} else if ((FLAG_SET(d->flags.batch) || FLAG_SET(d->flags.merge)) &&
+		(d->memo_fd >= 0 || d->dfa_fd >= 0 || (d->in_file !=
+		(char *)NULL && strcmp(d->in_file, DF_STDIO) == 0))) {
+		fprintf(stderr, "%s: -, -D and -A cannot be used with -b or -M\n",
+			PROGNAME);
+		dff_Usage();
+	} else if (FLAG_SET(d->flags.batch)) {
+		/*
+			-b: every free-standing argument names files.
+		 */
+		if (d->out_file != (char *)NULL || d->model != (char *)NULL ||
+			d->split != DF_NOT_SPLIT) {
+			fprintf(stderr, "%s: -o, -m and -s cannot be used with -b\n",
+				PROGNAME);
+			dff_Usage();
+		}
+		for (i = 0 ; i < num_names ; i++)
+			dff_BatchExpand(d, names[i]);
+		free((char *)names);
+		if (d->num_batch == 0) {
+			fprintf(stderr, "%s: no dBase files found\n", PROGNAME);
+			dff_Usage();
+		}
+		d->out_dir = THIS_DIR;
+		return;
+	}
+	if (FLAG_SET(d->flags.merge)) {
+		/*
+			-M: every free-standing argument names files,
+			merged in the order given.
+		 */
+		if (FLAG_SET(d->flags.pipeline) || d->key_how == DF_KEY_RANGE ||
+			FLAG_SET(d->flags.incremental) || d->ckp_recs > 0L) {
+			fprintf(stderr, "%s: -c, -i, -l, -r and -k rN cannot be used with -M\n",
+				PROGNAME);
+			dff_Usage();
+		}
+		for (i = 0 ; i < num_names ; i++)
+			dff_BatchExpand(d, names[i]);
+		if (d->num_batch == 0) {
+			fprintf(stderr, "%s: no dBase files found\n", PROGNAME);
+			dff_Usage();
+		}
+		d->in_file = d->batch[0].name;
+	}
+	free((char *)names);
+
+	if (d->in_file != (char *)NULL &&
+		((d->out_file != (char *)NULL &&
+		strcmp(d->out_file, DF_STDIO) == 0) ||
+		(d->out_file == (char *)NULL &&
+		strcmp(d->in_file, DF_STDIO) == 0))) {
+		/*
+			the .dff goes to stdout, so nothing else may;
+			its addresses are held until the .dfa is
+			written to -A.
+		 */
+		d->out_file = DF_STDIO;
+		d->flags.dff_pipe = (unsigned)1;
+		d->flags.terse = (unsigned)1;
+		d->addr_limit = DF_ADDR_ALL;
+	}
+
+	if (d->in_file == (char *)NULL) {
+		fprintf(stderr, "%s: no dBase file given\n", PROGNAME);
+		dff_Usage();
+	} else if ((FLAG_SET(d->flags.dff_pipe) || d->dfa_fd >= 0 ||
+		FLAG_SET(d->flags.zip) || strcmp(d->in_file, DF_STDIO) == 0) &&
+		(FLAG_SET(d->flags.incremental) || d->ckp_recs > 0L)) {
+		fprintf(stderr, "%s: -c, -i and -r cannot be used with -, -o -, -A or -z\n",
+			PROGNAME);
+		dff_Usage();
+	} else if (strcmp(d->in_file, DF_STDIO) == 0 &&
+		d->key_how == DF_KEY_RANGE) {
+		fprintf(stderr, "%s: -k rN cannot be used with a dBase file on stdin\n",
+			PROGNAME);
+		dff_Usage();
+	} else if (FLAG_SET(d->flags.dff_pipe) &&
+		(d->dfa_fd < 0 || d->model == (char *)NULL)) {
+		fprintf(stderr, "%s: -o - needs -A and -m\n", PROGNAME);
+		dff_Usage();
+	} else if (FLAG_SET(d->flags.dff_pipe) &&
+		FLAG_SET(d->flags.index)) {
+		fprintf(stderr, "%s: -x cannot be used with -o -\n", PROGNAME);
+		dff_Usage();
+	} else if (d->dfa_fd >= 0 && d->split != DF_NOT_SPLIT) {
+		fprintf(stderr, "%s: -A cannot be used with -s\n", PROGNAME);
+		dff_Usage();
+	} else if (d->key_how != DF_KEY_LETTER &&
+		d->split == DF_NOT_SPLIT) {
+		fprintf(stderr, "%s: -k needs a -s field\n", PROGNAME);
+		dff_Usage();
+	} else if (FLAG_SET(d->flags.incremental) &&
+		d->key_how == DF_KEY_RANGE) {
+		fprintf(stderr, "%s: -i cannot be used with -k rN\n", PROGNAME);
+		dff_Usage();
+	} else if (FLAG_SET(d->flags.pipeline) && d->num_jobs > 1) {
+		fprintf(stderr, "%s: -l and -j cannot be used together\n",
+			PROGNAME);
+		dff_Usage();
+	} else if (FLAG_NOT_SET(d->flags.terse))
+		/*
+			output file is specified
+		 */
+		printf("infile: %s.%s\n", d->in_file, DF_DF_EXT);
+
+	if (d->out_file == (char *)NULL)
+		/*
+			converted database will have the same name as input.
+		 */
+		d->out_file = d->in_file;
+	else if (FLAG_NOT_SET(d->flags.terse))
+		/*
+			output file is specified
+		 */
+		printf("outfile: %s.%s\n", d->out_file, DF_DF_EXT);
+
+	if (d->model == (char *)NULL)
+		/*
+			no model name, out_file it will be.
+		 */
+		d->model = d->out_file;
+
+	if (d->out_dir == (char *)NULL)
+		/*
+			the .dff/.dfa files will stay in current directory.
+		 */
+		d->out_dir = THIS_DIR;
+	else
+		/*
+			feel free to add the process necessary to
+			create an output directory.
+			simply prepend the directory name to the
+			.dff and .dfa files when opening/accessing them.
+			code is already in place for placing the directory
+			in to the .dfh header file.
+		 */
+		d->out_dir = THIS_DIR;
+}
+
+/*+
+	Dfile_WriteComment()
+
+	Parameters
+		`fp' is the output file pointer.
+		`text' is the comment string.
+
+	Description
+		write a DW format comment string to the output file.
+
+	Calls
+		System
+			fprintf().
+
+	History
+		dw	15 dec 92
+ +*/
+void	Dfile_WriteComment(fp, text)
+FILE	*fp;
+char	*text;
+{
+	fprintf(fp, "#\n#\t%s\n#\n", text);
+}
+
+/*+
+	Dfile_WriteHeaderTop()
+
+	Parameters
+		`d' is the info struct.
+
+	Description
+		the -g option was chose; a Dfile header file is being
+		created.  open the .dfh file and write Dfile-specific
+		things to it.
+
+	Calls
+		System
+			fopen(), fprintf().
+		Local
+			dff_OutOfSpace(), CheckDiskSpace(), dff_FileAndExt().
+
+	Alters
+		Incoming
+			`d->dfh'.
+
+	History
+		dw	15 dec 92
+ +*/
+void	Dfile_WriteHeaderTop(d)
+DF_INFO	*d;
+{
+	if ((d->dfh = fopen(dff_FileAndExt(d, d->model,
+		DF_HDR_EXT), "w")) == (FILE *)NULL)
+		dff_OutOfSpace(d);
+	Dfile_WriteComment(d->dfh, "Dfile Version");
+	fprintf(d->dfh, "char\tVersion\t{%s}\n", DF_VERSION_STRING);
+	Dfile_WriteComment(d->dfh, "Dfile Model name");
+	fprintf(d->dfh, "char\tModel\t{%s}\n", d->model);
+	Dfile_WriteComment(d->dfh, "Dfile introduction screens");
+	fprintf(d->dfh, "int\tNumScreens\t2\n");
+	fprintf(d->dfh, "char\tScreenNames[NumScreens]\n");
+	fprintf(d->dfh, "{IntroScreen1}\t{IntroScreen2}\n");
+	fprintf(d->dfh, "char\tIntroScreen1[2]\n");
+	fprintf(d->dfh, "{dBase file `%s' converted by %s version %s}\n",
+		d->in_file, PROGNAME, DF_VERSION_STRING);
+	fprintf(d->dfh, "{for use with the %s model of Dfile}\n", d->model);
+	fprintf(d->dfh, "char\tIntroScreen2[5]\n");
+	fprintf(d->dfh, "{Dfile written 13 Dec 92 by:}\n");
+	fprintf(d->dfh, "{David Whittemore - del@ecn.purdue.edu}\n");
+	fprintf(d->dfh, "{National Soil Erosion Research Laboratory}\n");
+	fprintf(d->dfh, "{West LaFayette, Indiana}\n");
+	fprintf(d->dfh, "{ph: 317 494 8694}\n");
+	fprintf(d->dfh, "char\tDataDirectory\t{%s}\n", d->out_dir);
+	fprintf(d->dfh, "int\tNumFields\t%d\n", d->num_proj);
+	fprintf(d->dfh,
+		"#\n#\t{name}\t{%s.%s file look-up}\t{type}\t{len}\n#\n",
+		d->model, DF_HLP_EXT);
+	fprintf(d->dfh, "char\tModelFields[NumFields][4]\n");
+	CheckDiskSpace(d, d->dfh);
+}
+
+/*+
+	Dfile_WriteHelpText()
+
+	Parameters
+		`d' is the info struct.
+		`ptr' is the field name.
+
+	Description
+		the -h option was chosen; a Dfile help file is being
+		generated.  write Dfile-specific info to the help file.
+
+	Calls
+		System
+			fprintf().
+		Local
+			CheckDiskSpace().
+
+	History
+		dw	15 dec 92
+ +*/
+void	Dfile_WriteHelpText(d, ptr)
+DF_INFO	*d;
+char	*ptr;
+{
+	fprintf(d->hlp, "disp %s\n", ptr);
+	fprintf(d->hlp, "free-format help for field `%s'\n", ptr);
+	fprintf(d->hlp, "can be edited in the ASCII file `%s.%s'\n",
+		d->model, DF_HLP_EXT);
+	fprintf(d->hlp, "$\n");
+	CheckDiskSpace(d, d->hlp);
+}
+
+/*+
+	Dfile_WriteHeaderField()
+
+	Parameters
+		`d' is the info struct.
+		`fld_name' is the field name.
+		`indx' is the field index.
+
+	Description
+		the -g option was chosen; a Dfile .dfh file is
+		being generated.  add the Dfile-specific information
+		for `fld_name' to the .dfh file.
+
+	Calls
+		System
+			strcpy(), fprintf().
+		Local
+			CheckDiskSpace().
+
+	History
+		dw	15 dec 92
+ +*/
+void	Dfile_WriteHeaderField(d, fld_name, indx)
+DF_INFO	*d;
+char	*fld_name;
+int	indx;
+{
+	/*
+		write the header info.
+	 */
+	fprintf(d->dfh, "{%s}\t{%s}\t{%s}\t{%d}\n",
+		fld_name,	/* the name of the field */
+		fld_name,	/* the help file look-up value for the field */
+		(d->fld_type[indx] == DBASE_NUMERIC_FLD ?	/* Dfile type */
+			(d->fld_dec[indx] == 0 ? "INT" : "FLT") :
+			(d->fld_type[indx] == DBASE_MEMO_FLD ? "MEMO" : "ALP")),
+		/*
+			the Dfile program needs the memo field to
+			contain the ASCII representation of the field
+			separator so that it can decode line breaks.
+		 */
+		(d->fld_type[indx] == DBASE_MEMO_FLD ?		/* field len */
+			DF_DELIM :
+		/*
+			all other field contains their field width
+		 */
+		d->fld_len[indx]));
+
+	CheckDiskSpace(d, d->dfh);
+}
+
+/*+
+	Dfile_WriteHeaderBottom()
+
+	Parameters
+		`d' is the info struct.
+
+	Description
+		the -g option was chosen; a Dfile .dfh file is
+		being generated.  finish-up Dfile-specific information
+		for the .dfh file, and then close it.
+		then write the .dfw window file.
+
+	Calls
+		System
+			fopen(), fclose(), fprintf().
+		Local
+			Dfile_WriteComment(), dff_FileAndExt(),
+			dff_OutOfSpace(), CheckDiskSpace().
+
+	Alters
+		Incoming
+			`d->dfh', `d->dfw'.
+
+	History
+		dw	15 dec 92
+ +*/
+void	Dfile_WriteHeaderBottom(d)
+DF_INFO	*d;
+{
+	/*
+		close the Dfile header file.
+	 */
+	fclose(d->dfh);
+	d->dfh = (FILE *)NULL;
+
+	if ((d->dfw = fopen(dff_FileAndExt(d, d->model,
+		DF_WIN_EXT), "w")) == (FILE *)NULL)
+		dff_OutOfSpace(d);
+	/*
+		write the Dfile window file.
+	 */
+	Dfile_WriteComment(d->dfw, "Dfile Version");
+	fprintf(d->dfw, "char\tVersion\t{%s}\n", DF_VERSION_STRING);
+	Dfile_WriteComment(d->dfw, "Dfile Model name");
+	fprintf(d->dfw, "char\tModel\t{%s}\n", d->model);
+	fprintf(d->dfw, "int\tUserListMax\t%d\n", d->num_proj);
+	fprintf(d->dfw, "int\tNumWindows\t1\n");
+	fprintf(d->dfw, "int\tTopWindow\t1\n");
+	fprintf(d->dfw, "char\tWindowFile[NumWindows]\n{%s}\n",
+		d->out_file);
+	fprintf(d->dfw, "char\tWindowGeometry[NumWindows][4]\n");
+	fprintf(d->dfw, "{%d}\t{%d}\t{%d}\t{%d}\n",
+		DF_WIN_GEOM_SX, DF_WIN_GEOM_SY,
+		DF_WIN_GEOM_EX, DF_WIN_GEOM_EY);
+	fprintf(d->dfw, "char\tTextGeometry[NumWindows][4]\n");
+	fprintf(d->dfw, "{%d}\t{%d}\t{%d}\t{%d}\n",
+		DF_TEXT_GEOM_SX, DF_TEXT_GEOM_SY,
+		DF_TEXT_GEOM_EX, DF_TEXT_GEOM_EY);
+	fprintf(d->dfw, "char\tUserListSize[NumWindows]\n{%d}\n",
+		d->num_proj);
+	fprintf(d->dfw, "char\tUserList[NumWindows][UserListMax]\n");
+	{
+		/*
+			write field ordering and search constraints.
+		 */
+		int	i;
+		for (i = 0 ; i < d->num_proj ; i++) {
+			fprintf(d->dfw,
+				"{%d%c%d%c%s%c%c%c%s}\n",
+				i + 1, DF_DELIM, i + 1, DF_DELIM,
+				DF_SEARCH_ALL, DF_DELIM, DF_DELIM,
+				DF_DELIM, DF_SEARCH_INCLUSIVE);
+		}
+	}
+	CheckDiskSpace(d, d->dfw);
+	fclose(d->dfw);
+	d->dfw = (FILE *)NULL;
+}
+
+/*+
+	dBase_SpoolFile()
+
+	Parameters
+		`d' is the info struct.
+		`fp' is a file that cannot be mapped, such as a pipe.
+
+	Description
+		copy all of `fp' to an unlinked temp file, to be read
+		as the memo file would be, through the block cache.
+		`fp' is closed.
+
+	Calls
+		System
+			tmpfile(), fread(), fwrite(), fflush(), rewind(),
+			fclose(), malloc(), free().
+		Local
+			dff_OutOfSpace().
+
+	Alters
+		Incoming
+			`d->flags.memo_spool'.
+
+	Return Values
+		Explicit
+			returns the temp file.
+
+	History
+		ag	16 oct 26
+ +*/
+FILE	*dBase_SpoolFile(d, fp)
+DF_INFO	*d;
+FILE	*fp;
+{
+	FILE	*tmp;
+	char	*buffer;
+	long	n;
+
+	if ((tmp = tmpfile()) == (FILE *)NULL ||
+		(buffer = (char *)malloc(DF_OUT_BUFSIZE)) == (char *)NULL)
+		dff_OutOfSpace(d);
+	while ((n = (long)fread(buffer, 1, DF_OUT_BUFSIZE, fp)) > 0L)
+		if ((long)fwrite(buffer, 1, (size_t)n, tmp) != n) {
+			free(buffer);
+			dff_OutOfSpace(d);
+		}
+	free(buffer);
+	fclose(fp);
+	if (fflush(tmp) != 0) dff_OutOfSpace(d);
+	rewind(tmp);
+	d->flags.memo_spool = (unsigned)1;
+	return tmp;
+}
+
+#ifdef	DF_HAVE_ZLIB
+/*+
+	dBase_Inflate()
+
+	Parameters
+		`d' is the info struct.
+		`fd' is a gzip'd memo file, or a pipe; it is
+			taken over and closed.
+
+	Description
+		uncompress all of `fd' into an unlinked temp file,
+		to be read through the block cache as the file of
+		dBase_SpoolFile() is.  gzread() copies what is not
+		gzip'd as it is.  a file cut short is an error.
+
+	Calls
+		System
+			gzdopen(), gzbuffer(), gzread(), gzclose(), tmpfile(),
+			fwrite(), fflush(), rewind(), fprintf(), malloc(),
+			free().
+		Local
+			dff_OutOfSpace(), dff_CleanUp().
+
+	Alters
+		Incoming
+			`d->flags.memo_spool'.
+
+	Return Values
+		Explicit
+			returns the temp file.
+
+	History
+		ag	16 oct 26
+ +*/
+FILE	*dBase_Inflate(d, fd)
+DF_INFO	*d;
+int	fd;
+{
+	FILE	*tmp;
+	gzFile	gz;
+	char	*buffer;
+	long	n;
+
+	if ((gz = gzdopen(fd, "rb")) == (gzFile)NULL ||
+		(tmp = tmpfile()) == (FILE *)NULL ||
+		(buffer = (char *)malloc(DF_ZIP_BUFSIZE)) == (char *)NULL)
+		dff_OutOfSpace(d);
+	(void)gzbuffer(gz, DF_ZIP_BUFSIZE);
+	while ((n = (long)gzread(gz, buffer, DF_ZIP_BUFSIZE)) > 0L)
+		if ((long)fwrite(buffer, 1, (size_t)n, tmp) != n) {
+			free(buffer);
+			dff_OutOfSpace(d);
+		}
+	free(buffer);
+	if (gzclose(gz) != Z_OK || n < 0L) {
+		/*
+			Z_BUF_ERROR: the file ends part way through.
+		 */
+		fprintf(stderr, "%s: cannot uncompress the memo file\n",
+			PROGNAME);
+		fclose(tmp);
+		dff_CleanUp(d, DF_FAILURE);
+	}
+	if (fflush(tmp) != 0) dff_OutOfSpace(d);
+	rewind(tmp);
+	d->flags.memo_spool = (unsigned)1;
+	return tmp;
+}
+#endif
+
+/*+
+	dBase_OpenFile()
+
+	Parameters
+		`d' is the info struct.
+		`ext' is the extension of the dBase or memo file.
+		`memo' is non-zero for the memo file.
+
+	Description
+		open `d->in_file'.`ext', in lower or upper case, or
+		with .gz, for dBase_Unzip().
+
+	Calls
+		System
+			fopen().
+		Local
+			dff_FindDbase(), dBase_Unzip().
+
+	Return Values
+		Explicit
+			returns the file, or NULL.
+
+	History
+		ag	16 oct 26
+ +*/
+FILE	*dBase_OpenFile(d, ext, memo)
+DF_INFO	*d;
+char	*ext;
+int	memo;
+{
+	char	*name = dff_FindDbase(d, d->in_file, ext);
+
+	return dBase_Unzip(d, (name == (char *)NULL ? (FILE *)NULL :
+		fopen(name, "rb")), memo);
+}
+
+/*+
+	dBase_Unzip()
+
+	Parameters
+		`d' is the info struct.
+		`fp' is a dBase or memo file just opened (or NULL).
+		`memo' is non-zero for the memo file.
+
+	Description
+		a gzip'd .dbf is read through a pipe from a helper
+		thread that uncompresses it, so it reads as a pipe.
+		so is a piped .dbf, which may be gzip'd; gzread()
+		passes what is not through as it is.  a gzip'd or
+		piped memo file is uncompressed by dBase_Inflate()
+		instead, as it is read out of order.
+
+	Calls
+		System
+			fstat(), fileno(), lseek(), pread(), dup(), fclose(),
+			fdopen(), malloc().
+		Local
+			dff_ZipOpen(), dBase_Inflate(), dff_OutOfSpace().
+
+	Alters
+		Incoming
+			`d->dbf_zip'.
+
+	Return Values
+		Explicit
+			returns the file to read, or NULL.
+
+	History
+		ag	16 oct 26
+ +*/
+FILE	*dBase_Unzip(d, fp, memo)
+DF_INFO	*d;
+FILE	*fp;
+int	memo;
+{
+#ifdef	DF_HAVE_ZLIB
+	struct stat	st;
+	unsigned char	magic[2];
+	DF_ZIP		*zip;
+	int		fd;
+
+	if (fp == (FILE *)NULL)
+		return fp;
+	fd = fileno(fp);
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) &&
+		(pread(fd, (char *)magic, 2, lseek(fd, 0L, 1)) != 2 ||
+		magic[0] != DF_GZ_MAGIC_1 || magic[1] != DF_GZ_MAGIC_2))
+		return fp;
+	/*
+		nothing has been read from `fp', so the helper
+		reads from where it stands.
+	 */
+	fd = dup(fd);
+	fclose(fp);
+	if (fd < 0) dff_OutOfSpace(d);
+	if (memo)
+		return dBase_Inflate(d, fd);
+	if ((zip = (DF_ZIP *)malloc(sizeof(DF_ZIP))) == (DF_ZIP *)NULL)
+		dff_OutOfSpace(d);
+	fp = fdopen(dff_ZipOpen(d, zip, fd, 0), "rb");
+	d->dbf_zip = zip;
+#else
+	(void)d; (void)memo;
+#endif
+	return fp;
+}
+
+/*+
+	dBase_OpenStream()
+
+	Parameters
+		`d' is the info struct.
+		`fp' is the .dbf: stdin, a gzip'd file, or a file.
+
+	Description
+		a file is read as any other.  a pipe cannot be
+		sought in, so its header is read into memory, to be
+		read from there by dBase_Init(); the records are
+		then read from `d->dbf_in', in order.
+
+	Calls
+		System
+			fstat(), fileno(), fread(), malloc(), memcpy(),
+			fmemopen().
+		Local
+			dff_BytesToLong(), dff_OutOfSpace().
+
+	Alters
+		Incoming
+			`d->dbf_head', `d->dbf_in', `d->flags.dbf_pipe'.
+
+	Return Values
+		Explicit
+			returns the file to read the header from, or NULL.
+
+	History
+		ag	16 oct 26
+ +*/
+FILE	*dBase_OpenStream(d, fp)
+DF_INFO	*d;
+FILE	*fp;
+{
+#ifdef	DF_HAVE_MMAP
+	struct stat	st;
+	char		top[DBASE_HEADER_SIZE];
+	long		len;
+
+	if (fp == (FILE *)NULL ||
+		(fstat(fileno(fp), &st) == 0 && S_ISREG(st.st_mode)))
+		return fp;
+	d->dbf_in = fp;
+	if (fread(top, 1, DBASE_HEADER_SIZE, fp) != DBASE_HEADER_SIZE ||
+		(len = dff_BytesToLong(&top[8], 2)) < DBASE_HEADER_SIZE)
+		return (FILE *)NULL;
+	if ((d->dbf_head = (char *)malloc((size_t)len)) == (char *)NULL)
+		dff_OutOfSpace(d);
+	memcpy(d->dbf_head, top, DBASE_HEADER_SIZE);
+	if (fread(d->dbf_head + DBASE_HEADER_SIZE, 1,
+		(size_t)(len - DBASE_HEADER_SIZE), fp) !=
+		(size_t)(len - DBASE_HEADER_SIZE) ||
+		(fp = fmemopen((void *)d->dbf_head, (size_t)len, "rb")) ==
+		(FILE *)NULL)
+		return (FILE *)NULL;
+	d->flags.dbf_pipe = (unsigned)1;
+#endif
+	return fp;
+}
+
+/*+
+	dBase_Close()
+
+	Parameters
+		`d' is the info struct.
+
+	Description
+		close the dBase files, and wait for the helper threads
+		of gzip'd ones.
+
+	Calls
+		System
+			fclose(), free().
+		Local
+			dBase_UnmapFile(), dff_ZipEnd().
+
+	Alters
+		Incoming
+			`d'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dBase_Close(d)
+DF_INFO	*d;
+{
+	if (d->dbf != (FILE *)NULL) fclose(d->dbf);
+	if (d->dbf_in != (FILE *)NULL) fclose(d->dbf_in);
+	if (d->dbt != (FILE *)NULL) fclose(d->dbt);
+	d->dbf = d->dbf_in = d->dbt = (FILE *)NULL;
+	dBase_UnmapFile(d->dbf_map, d->dbf_map_len);
+	dBase_UnmapFile(d->dbt_map, d->dbt_map_len);
+	d->dbf_map = d->dbt_map = (char *)NULL;
+#ifdef	DF_HAVE_ZLIB
+	/*
+		their pipes are closed, so they stop.
+	 */
+	if (d->dbf_zip != (DF_ZIP *)NULL) {
+		(void)dff_ZipEnd(d->dbf_zip);
+		free((char *)d->dbf_zip);
+	}
+	d->dbf_zip = (DF_ZIP *)NULL;
+#endif
+}
+
+/*+
+	dBase_OpenMemos()
+
+	Parameters
+		`d' is the info struct.
+		`type' is DBASE_MEMO_III, DBASE_MEMO_IV or DBASE_MEMO_FOX.
+
+	Description
+		open the memo file that goes with the .dbf; the .dbt
+		for dBase, or the .fpt for FoxPro.  the memo block size
+		is taken from the memo file header.  -D gives it as a
+		descriptor instead.  memos read from a pipe, or from a
+		gzip'd file, are copied to a temp file first.
+
+	Calls
+		System
+			fdopen(), fstat(), fileno(), fprintf(), printf(),
+			fread(), strcmp().
+		Local
+			dBase_OpenFile(), dBase_Unzip(), dBase_SpoolFile(),
+			dff_BytesToLong(), dff_CleanUp().
+
+	Alters
+		Incoming
+			`d->dbt', `d->dbt_map', `d->memo_type',
+			`d->memo_block'.
+
+	History
+		ag	16 oct 26
+ +*/
+void	dBase_OpenMemos(d, type)
+DF_INFO	*d;
+int	type;
+{
+	char	*ext = (type == DBASE_MEMO_FOX ? DBASE_FPT_EXT : DBASE_DBT_EXT),
+		head[DBASE_HEADER_SIZE],
+		*top = head;
+
+	if (FLAG_NOT_SET(d->flags.terse)) printf("has MEMOs\n");
+	if (d->memo_fd >= 0) {
+		/*
+			-D: the memo file is open already.
+		 */
+		if ((d->dbt = dBase_Unzip(d, fdopen(d->memo_fd, "rb"), 1)) ==
+			(FILE *)NULL) {
+			fprintf(stderr, "%s: cannot read memo file descriptor %d\n",
+				PROGNAME, d->memo_fd);
+			dff_CleanUp(d, DF_FAILURE);
+		}
+	} else if (strcmp(d->in_file, DF_STDIO) == 0) {
+		fprintf(stderr, "%s: a dBase file on stdin needs -D for its memos\n",
+			PROGNAME);
+		dff_CleanUp(d, DF_FAILURE);
+	} else if ((d->dbt = dBase_OpenFile(d, ext, 1)) == (FILE *)NULL) {
+		fprintf(stderr, "%s: cannot open memo file `%s.%s'\n",
+			PROGNAME, d->in_file, ext);
+		dff_CleanUp(d, DF_FAILURE);
+	}
+#ifdef	DF_HAVE_MMAP
+	{
+		struct stat	st;
+
+		if (fstat(fileno(d->dbt), &st) != 0 || !S_ISREG(st.st_mode))
+			d->dbt = dBase_SpoolFile(d, d->dbt);
+	}
+#endif
+
+	d->memo_type = type;
+	d->memo_block = 0;
+	if (type != DBASE_MEMO_III) {
+		if (d->dbt_map != (char *)NULL)
+			top = (d->dbt_map_len >= DBASE_HEADER_SIZE ?
+				d->dbt_map : (char *)NULL);
+		else if (fread(head, 1, DBASE_HEADER_SIZE, d->dbt) !=
+			DBASE_HEADER_SIZE)
+			top = (char *)NULL;
+	}
+	if (type != DBASE_MEMO_III && top != (char *)NULL) {
+		if (type == DBASE_MEMO_FOX)
+			d->memo_block = ((top[FOXPRO_BLOCK_OFFSET] & 0xff) << 8) |
+				(top[FOXPRO_BLOCK_OFFSET + 1] & 0xff);
+		else
+			d->memo_block = (int)dff_BytesToLong(
+				&top[DBASE4_BLOCK_OFFSET], 2);
+	}
+	if (d->memo_block <= 0)
+		d->memo_block = DBASE_MEMO_BLOCK;
+}
+
+/*+
+	dBase_Init()
+
+	Parameters
+		`d' is the info struct.
+
+	Description
+		attempt to open dBase files, check their integrity,
+		and set-up Dfile field info.  dBase III, dBase IV,
+		FoxBase, FoxPro and Visual FoxPro tables are known.
+
+	Calls
+		System
+			open(), fseek(), ftell(), fprintf(), malloc(),
+			printf(), fread(), fopen(), fclose(), strcpy(),
+			strlen(), strcmp().
+		Local
+			dff_FileAndExt(), dff_CleanUp() dff_BytesToLong(),
+			dff_InitParts(), dBase_OpenFile(), dBase_Unzip(),
+			dBase_OpenStream(),
+			dBase_OpenMemos(), dBase_Project(), dBase_MapFile(),
+			dBase_CompilePlan(), dBase_CompileFilter(),
+			dBase_Sample(), dBase_InitMemos(),
+			Dfile_WriteHeaderTop(), Dfile_WriteHeaderField(),
+			Dfile_WriteHeaderBottom(), Dfile_WriteHelpText(),
+			dff_StripString(), dff_OutOfSpace().
+
+	Alters
+		Incoming
+			`d'.
+
+	History
+		dw	15 dec 92
+ +*/
+void	dBase_Init(d)
+DF_INFO	*d;
+{
+	unsigned char	cookie;
+
+	/*
+		the output Dfile databases known so far.
+	 */
+	dff_InitParts(d);
+
+	if ((d->dbf = dBase_OpenStream(d, (strcmp(d->in_file, DF_STDIO) == 0 ?
+		dBase_Unzip(d, stdin, 0) :
+		dBase_OpenFile(d, DBASE_DBF_EXT, 0)))) == (FILE *)NULL) {
+		if (strcmp(d->in_file, DF_STDIO) == 0)
+			fprintf(stderr, "%s: no dBase header on stdin\n",
+				PROGNAME);
+		else
+			fprintf(stderr, "%s: cannot open dBase file `%s.dbf'\n",
+				PROGNAME, d->in_file);
+		dff_CleanUp(d, DF_FAILURE);
+	}
+	if (FLAG_SET(d->flags.dbf_pipe) && (d->key_how == DF_KEY_RANGE ||
+		FLAG_SET(d->flags.incremental) || d->ckp_recs > 0L)) {
+		/*
+			a gzip'd .dbf cannot be sought in either.
+		 */
+		fprintf(stderr, "%s: `%s.dbf' is read in order; -c, -i, -r and -k rN cannot be used\n",
+			PROGNAME, d->in_file);
+		dff_CleanUp(d, DF_FAILURE);
+	}
+
+	/*
+		read the dBase header
+	 */
+	fseek(d->dbf, 0L, 0);
+	
+	switch (cookie = GetByte(d->dbf)) {
+		case DBASE_COOKIE:
+			break;
+		case DBASE_MEMO_COOKIE:
+		case FOXBASE_MEMO_COOKIE:
+			dBase_OpenMemos(d, DBASE_MEMO_III);
+			break;
+		case DBASE4_MEMO_COOKIE:
+		case DBASE4_SQL_MEMO_COOKIE:
+			dBase_OpenMemos(d, DBASE_MEMO_IV);
+			break;
+		case FOXPRO_MEMO_COOKIE:
+			dBase_OpenMemos(d, DBASE_MEMO_FOX);
+			break;
+		case VFP_COOKIE:
+		case VFP_AUTOINC_COOKIE:
+		case VFP_VARCHAR_COOKIE:
+			/*
+				Visual FoxPro flags its memos in the header.
+			 */
+			fseek(d->dbf, (long)VFP_FLAGS_OFFSET, 0);
+			if (GetByte(d->dbf) & VFP_HAS_MEMO)
+				dBase_OpenMemos(d, DBASE_MEMO_FOX);
+			fseek(d->dbf, 1L, 0);
+			break;
+		default:
+			fprintf(stderr, "%s: `%s.dbf' not dBase format.\n",
+				PROGNAME, d->in_file);
+			dff_CleanUp(d, DF_FAILURE);
+	}
+
+	/*
+		skip past the date bytes
+	 */
+	GetByte(d->dbf); GetByte(d->dbf); GetByte(d->dbf);
+	/*
+		set up number of things and allocate buffers
+	 */
+	d->num_records = GetLong(d->dbf);
+	d->num_flds = ((d->data_offset = GetInt(d->dbf)) -
+		DBASE_HEADER_SIZE) / DBASE_HEADER_SIZE;
+	{
+		/*
+			the field descriptors end at DBASE_FIELD_END;
+			Visual FoxPro has more header after them.
+		 */
+		long	here = ftell(d->dbf);
+		int	n;
+
+		for (n = 0 ; n < d->num_flds ; n++) {
+			fseek(d->dbf, (long)((n + 1) * DBASE_HEADER_SIZE), 0);
+			if (GetByte(d->dbf) == DBASE_FIELD_END) break;
+		}
+		d->num_flds = n;
+		fseek(d->dbf, here, 0);
+	}
+	d->fld_type = (int *)malloc(sizeof(int) * d->num_flds);
+	d->fld_dec = (int *)malloc(sizeof(int) * d->num_flds);
+	d->fld_len = (int *)malloc(sizeof(int) * d->num_flds);
+	d->rec_buffer = (char *)malloc(sizeof(char) * ((d->bytes =
+		GetInt(d->dbf)) + 1));
+	d->memo_buffer = (char *)malloc(sizeof(char) * (DF_MAX_MEMO_SIZE + 1));
+
+	/*
+		skip 20 reserved bytes
+	 */
+	GetLong(d->dbf); GetLong(d->dbf); GetLong(d->dbf);
+	GetLong(d->dbf); GetLong(d->dbf);
+
+	if (FLAG_NOT_SET(d->flags.terse)) {
+		/*
+			reporting..
+		 */
+		printf("%d fields per record\n", d->num_flds);
+		printf("%ld records to process\n", d->num_records);
+	}
+
+	if (d->split != DF_NOT_SPLIT) {
+		/*
+			split fields are specified as 1..n, used as 0..n-1
+		 */
+		d->split--;
+		if (d->split < 0 || d->split >= d->num_flds) {
+			fprintf(stderr, "%s: split field range: %d..%d\n",
+				PROGNAME, 1, d->num_flds);
+			dff_CleanUp(d, DF_FAILURE);
+		}
+	}
+
+	{
+		/*
+			get field info from dBase file.
+		 */
+		int	i, max_len = 0;
+
+		if ((d->fld_name = (char *)malloc(sizeof(char) *
+			d->num_flds * (DBASE_FLD_NAME_LEN + 1))) ==
+			(char *)NULL)
+			dff_OutOfSpace(d);
+
+		for (i = 0 ; i < d->num_flds ; i++) {
+			char	name[DBASE_FLD_NAME_LEN + 1],
+				*stripped_name = (char *)&name[0];
+
+			if (fread((char *)name, 1, DBASE_FLD_NAME_LEN,
+				d->dbf) != DBASE_FLD_NAME_LEN) {
+				fprintf(stderr,
+					"%s: problems reading field %d!\n",
+					PROGNAME, i + 1);
+				dff_CleanUp(d, DF_FAILURE);
+			}
+			name[DBASE_FLD_NAME_LEN] = '\0';
+			dff_StripString(&stripped_name, strlen(name));
+			strcpy(FieldName(d, i), stripped_name);
+
+			if ((d->fld_type[i] = GetByte(d->dbf)) == DBASE_FLOAT_FLD)
+				/*
+					dBase IV floats read as numbers.
+				 */
+				d->fld_type[i] = DBASE_NUMERIC_FLD;
+			GetLong(d->dbf);
+			d->fld_len[i] = GetByte(d->dbf);
+			d->fld_dec[i] = GetByte(d->dbf);
 			/*
-				set the dBase filename.
-				no wildcards, so the last free-standing
-				argument found will be the input file used.
-				since we allow the split option,
-				this only makes sense.
+				skip 14 reserved bytes
 			 */
-			if (d->in_file != (char *)NULL)
-				printf("%s: ignoring previous dBase file: %s\n",
-					PROGNAME, d->in_file);
-			d->in_file = argv[i];
+			GetLong(d->dbf); GetLong(d->dbf);
+			GetLong(d->dbf); (void)GetInt(d->dbf);
+
+			if (d->fld_len[i] > max_len)
+				max_len = d->fld_len[i];
+
+			if (i == d->split && d->split != DF_NOT_SPLIT) {
+				int	type = d->fld_type[i];
+
+				if (d->key_how == DF_KEY_LETTER &&
+					type != DBASE_CHARACTER_FLD) {
+					fprintf(stderr,
+					"%s: split field (%s) not CHAR type\n",
+						PROGNAME, stripped_name);
+					dff_CleanUp(d, DF_FAILURE);
+				} else if (type == DBASE_MEMO_FLD ||
+					(d->key_how == DF_KEY_BUCKET &&
+					type != DBASE_NUMERIC_FLD &&
+					type != DBASE_DATE_FLD)) {
+					fprintf(stderr,
+				"%s: split field (%s) cannot split by `%c'\n",
+						PROGNAME, stripped_name,
+						d->key_how);
+					dff_CleanUp(d, DF_FAILURE);
+				} else if (FLAG_NOT_SET(d->flags.terse))
+					printf("splitting on (%s)\n",
+						stripped_name);
+			}
+		}
+		d->fld_buffer = (char *)malloc(sizeof(char) * (max_len + 2));
+	}
+
+	/*
+		choose the fields to convert.
+	 */
+	dBase_Project(d);
+
+	{
+		/*
+			describe the converted fields.
+		 */
+		int	i;
+
+		if (FLAG_SET(d->flags.headers))
+			/*
+				if the header file is used, initialise it.
+			 */
+			Dfile_WriteHeaderTop(d);
+
+		if (FLAG_SET(d->flags.help))
+			/*
+				writing the help file template
+			 */
+			if ((d->hlp = fopen(dff_FileAndExt(d, d->model,
+				DF_HLP_EXT), "w")) == (FILE *)NULL)
+				dff_OutOfSpace(d);
+
+		for (i = 0 ; i < d->num_proj ; i++) {
+			if (FLAG_SET(d->flags.help))
+				/*
+					write the help template for this field
+				 */
+				Dfile_WriteHelpText(d, FieldName(d, d->proj[i]));
+			if (FLAG_SET(d->flags.headers))
+				/*
+					write the header info for this field
+				 */
+				Dfile_WriteHeaderField(d,
+					FieldName(d, d->proj[i]), d->proj[i]);
+		}
+
+		if (FLAG_SET(d->flags.help)) {
+			fclose(d->hlp);
+			d->hlp = (FILE *)NULL;
+		}
+	}
+
+	/*
+		read the dBase end-of-header byte
+	 */
+	GetByte(d->dbf);
+
+	/*
+		decode the records straight out of the mapped files
+		when possible; otherwise the records are read from
+		the start of the record data.  a piped .dbf is read
+		on from its header, in order.
+	 */
+	if (FLAG_SET(d->flags.dbf_pipe)) {
+		fclose(d->dbf);
+		d->dbf = d->dbf_in;
+		d->dbf_in = (FILE *)NULL;
+	} else {
+		d->dbf_map = dBase_MapFile(d->dbf, &d->dbf_map_len);
+		if (d->dbf_map == (char *)NULL)
+			fseek(d->dbf, d->data_offset, 0);
+	}
+	if (d->dbt != (FILE *)NULL && FLAG_NOT_SET(d->flags.memo_spool))
+		/*
+			a spooled memo file is read through the block
+			cache instead.
+		 */
+		d->dbt_map = dBase_MapFile(d->dbt, &d->dbt_map_len);
+	dBase_CompilePlan(d);
+	if (d->where != (char *)NULL)
+		dBase_CompileFilter(d);
+	if (d->key_how == DF_KEY_RANGE)
+		dBase_Sample(d);
+	if (d->dbt != (FILE *)NULL)
+		dBase_InitMemos(d);
+	if (FLAG_SET(d->flags.dbf_pipe))
+		/*
+			records cannot be read ahead of a pipe.
+		 */
+		d->prefetched = d->num_records;
+
+	if (FLAG_SET(d->flags.headers))
+		/*
+			finish up the .dfh and start the .dfw file.
+		 */
+		Dfile_WriteHeaderBottom(d);
+}
+
+/*+
+	dBase_SameFields()
+
+	Parameters
+		`d' is the info struct of the first -M dBase file.
+		`s' is that of another.
+
+	Description
+		check that a -M file has the same fields as the first:
+		their names, types, lengths and decimals.
+
+	Calls
+		System
+			strcmp(), fprintf().
+
+	Return Values
+		Explicit
+			returns 1 if they are the same, otherwise 0.
+
+	History
+		ag	16 oct 26
+ +*/
+int	dBase_SameFields(d, s)
+DF_INFO	*d,
+	*s;
+{
+	int	i;
+
+	if (s->num_flds != d->num_flds || s->bytes != d->bytes) {
+		fprintf(stderr, "%s: `%s' has %d fields (%d bytes), `%s' has %d (%d bytes)\n",
+			PROGNAME, s->in_file, s->num_flds, s->bytes,
+			d->in_file, d->num_flds, d->bytes);
+		return 0;
+	}
+	for (i = 0 ; i < d->num_flds ; i++)
+		if (strcmp(FieldName(s, i), FieldName(d, i)) != 0 ||
+			s->fld_type[i] != d->fld_type[i] ||
+			s->fld_len[i] != d->fld_len[i] ||
+			s->fld_dec[i] != d->fld_dec[i]) {
+			fprintf(stderr,
+				"%s: field %d of `%s' (%s %c%d.%d) is not %s %c%d.%d\n",
+				PROGNAME, i + 1, s->in_file, FieldName(s, i),
+				s->fld_type[i], s->fld_len[i], s->fld_dec[i],
+				FieldName(d, i), d->fld_type[i], d->fld_len[i],
+				d->fld_dec[i]);
+			return 0;
 		}
+	return 1;
+}
 
-	if (d->in_file == (char *)NULL) {
-		fprintf(stderr, "%s: no dBase file given\n", PROGNAME);
-		dff_Usage();
-	} else if (FLAG_NOT_SET(d->flags.terse))
-		/*
-			output file is specified
-		 */
-		printf("infile: %s.%s\n", d->in_file, DF_DF_EXT);
+/*+
+	dff_Convert()
 
-	if (d->out_file == (char *)NULL)
+	Parameters
+		`d' is the info struct, with its arguments decoded.
+
+	Description
+		convert one dBase file: open the dBase files, process
+		the dBase records, and clean-up.  dff_CleanUp() does
+		not return.
+
+	Calls
+		System
+			printf().
+		Local
+			dBase_Init(), dff_IoInit(), dff_ReadCheckpoint(),
+			dBase_Fingerprint(), dBase_ProcessRecord(),
+			dff_SaveCheckpoint(), dBase_ConvertParallel(),
+			dBase_ConvertPipelined(), dff_CleanUp().
+
+	History
+		ag	16 oct 26
+ +*/
+void	dff_Convert(d)
+DF_INFO	*d;
+{
+	dBase_Init(d);
+	dff_IoInit(d);
+	d->report = (int)(d->num_records / 100) + 1;
+	if (d->ckp_recs > 0L)
 		/*
-			converted database will have the same name as input.
+			-c keeps the addresses in the .dft files,
+			where a checkpoint can sync them.
 		 */
-		d->out_file = d->in_file;
-	else if (FLAG_NOT_SET(d->flags.terse))
+		d->addr_limit = 0L;
+	if (FLAG_SET(d->flags.incremental) || FLAG_SET(d->flags.resume))
+		dff_ReadCheckpoint(d);
+	else if (d->ckp_recs > 0L)
+		d->fingerprint = dBase_Fingerprint(d);
+	if (FLAG_SET(d->flags.dbf_pipe) && d->num_jobs > 1) {
 		/*
-			output file is specified
+			a pipe is read in order, by the -l read
+			stage; -j converts behind it.
 		 */
-		printf("outfile: %s.%s\n", d->out_file, DF_DF_EXT);
+		d->num_jobs = 1;
+		d->flags.pipeline = (unsigned)1;
+	}
+	d->ckp_at = (d->ckp_recs > 0L ? d->start_rec + d->ckp_recs :
+		d->num_records + 1L);
+	/*
+		process the records.
+	 */
+	if (FLAG_SET(d->flags.pipeline))
+		dBase_ConvertPipelined(d);
+	else if (d->num_jobs > 1)
+		dBase_ConvertParallel(d);
+	else for (d->rec_num = d->start_rec ; d->rec_num < d->num_records ;
+		d->rec_num++) {
+		dBase_ProcessRecord(d);
+		if (d->rec_num + 1L >= d->ckp_at)
+			dff_SaveCheckpoint(d, d->rec_num + 1L);
+	}
+	if (FLAG_NOT_SET(d->flags.terse))
+		printf("100%% converted\n");
+	/*
+		and exit.
+	 */
+	dff_CleanUp(d, DF_SUCCESS);
+}
 
-	if (d->model == (char *)NULL)
-		/*
-			no model name, out_file it will be.
-		 */
-		d->model = d->out_file;
+/*+
+	dff_Merge()
 
-	if (d->out_dir == (char *)NULL)
+	Parameters
+		`d' is the info struct, with its -M files listed.
+
+	Description
+		convert the -M files, in the order given, into one
+		Dfile database, as if their records were in a single
+		dBase file.  the other files are opened first, so a
+		file that will not open leaves no output behind; the
+		.dfh/.dfw/.hlp files come from the first.  each file
+		reads its own memos.  dff_CleanUp() does not return.
+
+	Calls
+		System
+			malloc(), free(), fclose(), printf(), fprintf().
+		Local
+			dBase_Init(), dBase_SameFields(), dff_IoInit(),
+			dBase_ConvertMerged(), dBase_Close(),
+			dff_FreeInfo(), dff_CleanUp(), dff_OutOfSpace().
+
+	History
+		ag	16 oct 26
+ +*/
+void	dff_Merge(d)
+DF_INFO	*d;
+{
+	DF_INFO	**src;
+	int	n = d->num_batch,
+		i;
+
+	if ((src = (DF_INFO **)malloc(sizeof(DF_INFO *) * n)) ==
+		(DF_INFO **)NULL)
+		dff_OutOfSpace(d);
+	src[0] = d;
+	for (i = 1 ; i < n ; i++) {
 		/*
-			the .dff/.dfa files will stay in current directory.
+			the other files only read records.
 		 */
-		d->out_dir = THIS_DIR;
-	else
+		if ((src[i] = (DF_INFO *)malloc(sizeof(DF_INFO))) ==
+			(DF_INFO *)NULL)
+			dff_OutOfSpace(d);
+		*src[i] = *d;
+		src[i]->in_file = d->batch[i].name;
+		src[i]->batch = (DF_BATCH *)NULL;
+		src[i]->num_batch = 0;
+		src[i]->flags.headers = src[i]->flags.help = (unsigned)0;
+		src[i]->flags.terse = (unsigned)1;
+		dBase_Init(src[i]);
+		d->batch[i].records = src[i]->num_records;
+	}
+	dBase_Init(d);
+	d->batch[0].records = d->num_records;
+	for (i = 1 ; i < n ; i++) {
+		if (!dBase_SameFields(d, src[i]))
+			dff_CleanUp(d, DF_FAILURE);
+		d->num_records += d->batch[i].records;
+	}
+	if (n > 1 && FLAG_NOT_SET(d->flags.terse))
+		printf("%ld records to process from %d files\n",
+			d->num_records, n);
+
+	for (i = 0 ; i < n ; i++)
+		if (FLAG_SET(src[i]->flags.dbf_pipe))
+			/*
+				a gzip'd file is read in order, so
+				its jobs cannot run side by side.
+			 */
+			d->num_jobs = 1;
+
+	dff_IoInit(d);
+	d->report = (int)(d->num_records / 100) + 1;
+	dBase_ConvertMerged(d, src, n);
+
+	for (i = 1 ; i < n ; i++) {
+		dBase_Close(src[i]);
+		dff_FreeInfo(src[i]);
+		free((char *)src[i]);
+	}
+	free((char *)src);
+	if (FLAG_NOT_SET(d->flags.terse))
+		printf("100%% converted\n");
+	dff_CleanUp(d, DF_SUCCESS);
+}
+
+/*+
+	dff_DbfLength()
+
+	Parameters
+		`name' is a file name.
+
+	Description
+		find the length of `name' less a .dbf extension, in
+		either case (or .dbf.gz, when gzip'd files can be
+		read); dff_FindDbase() finds the file again when it
+		is opened.
+
+	Calls
+		System
+			strlen(), strcmp(), tolower().
+
+	Return Values
+		Explicit
+			returns the length.
+
+	History
+		ag	16 oct 26
+ +*/
+int	dff_DbfLength(name)
+char	*name;
+{
+	int	len = strlen(name),
+		end = len,
+		i;
+
+#ifdef	DF_HAVE_ZLIB
+	if (end > 7 && strcmp(&name[end - 3], DF_GZ_SUFFIX) == 0)
+		end -= 3;
+#endif
+	if (end > 4 && name[end - 4] == '.') {
 		/*
-			feel free to add the process necessary to
-			create an output directory.
-			simply prepend the directory name to the
-			.dff and .dfa files when opening/accessing them.
-			code is already in place for placing the directory
-			in to the .dfh header file.
+			DOS wrote them as .DBF.
 		 */
-		d->out_dir = THIS_DIR;
+		for (i = 0 ; i < 3 &&
+			tolower(name[end - 3 + i]) == DBASE_DBF_EXT[i] ; i++)
+			;
+		if (i == 3)
+			return end - 4;
+	}
+	return len;
 }
 
 /*+
-	Dfile_WriteComment()
+	dff_BatchAdd()
 
 	Parameters
-		`fp' is the output file pointer.
-		`text' is the comment string.
+		`d' is the info struct.
+		`name' is a dBase file for -b or -M, with or without its
+		.dbf extension.
 
 	Description
-		write a DW format comment string to the output file.
+		add a dBase file to the -b or -M list.
 
 	Calls
 		System
-			fprintf().
+			malloc(), realloc(), strncpy().
+		Local
+			dff_DbfLength(), dff_OutOfSpace().
+
+	Alters
+		Incoming
+			`d->batch', `d->num_batch', `d->max_batch'.
 
 	History
-		dw	15 dec 92
+		ag	16 oct 26
  +*/
-void	Dfile_WriteComment(fp, text)
-FILE	*fp;
-char	*text;
+void	dff_BatchAdd(d, name)
+DF_INFO	*d;
+char	*name;
 {
-	fprintf(fp, "#\n#\t%s\n#\n", text);
+	DF_BATCH	*b;
+	int		len = dff_DbfLength(name);
+
+	if (d->num_batch == d->max_batch) {
+		int	max = (d->max_batch > 0 ? d->max_batch * 2 :
+				DF_BATCH_CHUNK);
+
+		if ((b = (DF_BATCH *)realloc((char *)d->batch,
+			sizeof(DF_BATCH) * max)) == (DF_BATCH *)NULL)
+			dff_OutOfSpace(d);
+		d->batch = b;
+		d->max_batch = max;
+	}
+	b = &d->batch[d->num_batch++];
+	if ((b->name = (char *)malloc(len + 1)) == (char *)NULL)
+		dff_OutOfSpace(d);
+	strncpy(b->name, name, len);
+	b->name[len] = '\0';
+	b->size = b->records = b->converted = 0L;
+	b->status = DF_FAILURE;
 }
 
 /*+
-	Dfile_WriteHeaderTop()
+	dff_BatchExpand()
 
 	Parameters
 		`d' is the info struct.
+		`arg' is a -b or -M command-line argument.
 
 	Description
-		the -g option was chose; a Dfile header file is being
-		created.  open the .dfh file and write Dfile-specific
-		things to it.
+		add the dBase files an argument names to the list:
+		every .dbf in a directory, the files matching a glob
+		the shell did not expand, the files listed one per
+		line in an @file, or else the argument itself.
 
 	Calls
 		System
-			fopen(), fprintf().
+			stat(), opendir(), readdir(), closedir(), qsort(),
+			glob(), globfree(), fopen(), fgets(), fclose(),
+			strlen(), strpbrk(), sprintf(), fprintf().
 		Local
-			dff_OutOfSpace(), CheckDiskSpace(), dff_FileAndExt().
+			dff_DbfLength(), dff_BatchAdd().
 
 	Alters
 		Incoming
-			`d->dfh'.
+			`d->batch'.
 
 	History
-		dw	15 dec 92
+		ag	16 oct 26
  +*/
-void	Dfile_WriteHeaderTop(d)
+void	dff_BatchExpand(d, arg)
 DF_INFO	*d;
+char	*arg;
 {
-	if ((d->dfh = fopen(dff_FileAndExt(d->model,
-		DF_HDR_EXT), "w")) == (FILE *)NULL)
-		dff_OutOfSpace(d);
-	Dfile_WriteComment(d->dfh, "Dfile Version");
-	fprintf(d->dfh, "char\tVersion\t{%s}\n", DF_VERSION_STRING);
-	Dfile_WriteComment(d->dfh, "Dfile Model name");
-	fprintf(d->dfh, "char\tModel\t{%s}\n", d->model);
-	Dfile_WriteComment(d->dfh, "Dfile introduction screens");
-	fprintf(d->dfh, "int\tNumScreens\t2\n");
-	fprintf(d->dfh, "char\tScreenNames[NumScreens]\n");
-	fprintf(d->dfh, "{IntroScreen1}\t{IntroScreen2}\n");
-	fprintf(d->dfh, "char\tIntroScreen1[2]\n");
-	fprintf(d->dfh, "{dBase file `%s' converted by %s version %s}\n",
-		d->in_file, PROGNAME, DF_VERSION_STRING);
-	fprintf(d->dfh, "{for use with the %s model of Dfile}\n", d->model);
-	fprintf(d->dfh, "char\tIntroScreen2[5]\n");
-	fprintf(d->dfh, "{Dfile written 13 Dec 92 by:}\n");
-	fprintf(d->dfh, "{David Whittemore - del@ecn.purdue.edu}\n");
-	fprintf(d->dfh, "{National Soil Erosion Research Laboratory}\n");
-	fprintf(d->dfh, "{West LaFayette, Indiana}\n");
-	fprintf(d->dfh, "{ph: 317 494 8694}\n");
-	fprintf(d->dfh, "char\tDataDirectory\t{%s}\n", d->out_dir);
-	fprintf(d->dfh, "int\tNumFields\t%d\n", d->num_flds);
-	fprintf(d->dfh,
-		"#\n#\t{name}\t{%s.%s file look-up}\t{type}\t{len}\n#\n",
-		d->model, DF_HLP_EXT);
-	fprintf(d->dfh, "char\tModelFields[NumFields][4]\n");
-	CheckDiskSpace(d, d->dfh);
+	if (arg[0] == '@') {
+		/*
+			a list of files.
+		 */
+		char	line[DF_NAME_LEN];
+		FILE	*fp;
+
+		if ((fp = fopen(&arg[1], "r")) == (FILE *)NULL) {
+			fprintf(stderr, "%s: cannot read list %s\n",
+				PROGNAME, &arg[1]);
+			return;
+		}
+		while (fgets(line, sizeof(line), fp) != (char *)NULL) {
+			int	len = strlen(line);
+
+			while (len > 0 && (line[len - 1] == '\n' ||
+				line[len - 1] == '\r' || line[len - 1] == ' '))
+				line[--len] = '\0';
+			if (len > 0 && line[0] != '@')
+				dff_BatchExpand(d, line);
+		}
+		fclose(fp);
+		return;
+	}
+#ifdef	DF_HAVE_GLOB
+	{
+		struct stat	st;
+
+		if (stat(arg, &st) == 0 && S_ISDIR(st.st_mode)) {
+			/*
+				every .dbf in the directory.
+			 */
+			DIR		*dir;
+			struct dirent	*ent;
+			char		name[DF_NAME_LEN];
+			int		first = d->num_batch;
+
+			if ((dir = opendir(arg)) == (DIR *)NULL) {
+				fprintf(stderr, "%s: cannot read %s\n",
+					PROGNAME, arg);
+				return;
+			}
+			while ((ent = readdir(dir)) != (struct dirent *)NULL)
+				if (dff_DbfLength(ent->d_name) <
+					(int)strlen(ent->d_name)) {
+					int	len = strlen(arg);
+
+					while (len > 1 && arg[len - 1] == '/')
+						len--;
+					sprintf(name, "%.*s/%.*s",
+						(len < DF_NAME_LEN / 2 ? len :
+						DF_NAME_LEN / 2 - 1), arg,
+						DF_NAME_LEN / 2 - 1, ent->d_name);
+					dff_BatchAdd(d, name);
+				}
+			closedir(dir);
+			/*
+				in name order, as -M merges them.
+			 */
+			qsort((char *)&d->batch[first], d->num_batch - first,
+				sizeof(DF_BATCH), dff_CompareName);
+			return;
+		}
+		if (strpbrk(arg, "*?[") != (char *)NULL) {
+			/*
+				a glob the shell left alone.
+			 */
+			glob_t	g;
+			size_t	i;
+
+			if (glob(arg, 0, NULL, &g) == 0) {
+				/*
+					only the .dbf files, as in a
+					directory.
+				 */
+				for (i = 0 ; i < g.gl_pathc ; i++)
+					if (dff_DbfLength(g.gl_pathv[i]) <
+						(int)strlen(g.gl_pathv[i]))
+						dff_BatchAdd(d, g.gl_pathv[i]);
+				globfree(&g);
+			} else
+				fprintf(stderr, "%s: nothing matches %s\n",
+					PROGNAME, arg);
+			return;
+		}
+	}
+#endif
+	dff_BatchAdd(d, arg);
 }
 
 /*+
-	Dfile_WriteHelpText()
+	dff_BatchSize()
 
 	Parameters
 		`d' is the info struct.
-		`ptr' is the field name.
+		`b' is a -b dBase file.
 
 	Description
-		the -h option was chosen; a Dfile help file is being
-		generated.  write Dfile-specific info to the help file.
+		find the bytes in the .dbf and its memo file, so the
+		largest files can be converted first.  a gzip'd file
+		counts its gzip'd bytes.
 
 	Calls
 		System
-			fprintf().
+			stat().
 		Local
-			CheckDiskSpace().
+			dff_FindDbase().
+
+	Alters
+		Incoming
+			`b->size'.
 
 	History
-		dw	15 dec 92
+		ag	16 oct 26
  +*/
-void	Dfile_WriteHelpText(d, ptr)
+void	dff_BatchSize(d, b)
 DF_INFO	*d;
-char	*ptr;
+DF_BATCH *b;
 {
-	fprintf(d->hlp, "disp %s\n", ptr);
-	fprintf(d->hlp, "free-format help for field `%s'\n", ptr);
-	fprintf(d->hlp, "can be edited in the ASCII file `%s.%s'\n",
-		d->model, DF_HLP_EXT);
-	fprintf(d->hlp, "$\n");
-	CheckDiskSpace(d, d->hlp);
+#ifdef	DF_HAVE_GLOB
+	struct stat	st;
+
+	char		*name;
+
+	b->size = 0L;
+	if ((name = dff_FindDbase(d, b->name, DBASE_DBF_EXT)) !=
+		(char *)NULL && stat(name, &st) == 0)
+		b->size += (long)st.st_size;
+	if (((name = dff_FindDbase(d, b->name, DBASE_DBT_EXT)) !=
+		(char *)NULL ||
+		(name = dff_FindDbase(d, b->name, DBASE_FPT_EXT)) !=
+		(char *)NULL) && stat(name, &st) == 0)
+		b->size += (long)st.st_size;
+#endif
+}
+
+/*+
+	dff_CompareBatch()
+
+	Description
+		qsort() comparison of two -b files, largest first.
+
+	History
+		ag	16 oct 26
+ +*/
+int	dff_CompareBatch(a, b)
+const void	*a,
+		*b;
+{
+	long	x = ((DF_BATCH *)a)->size,
+		y = ((DF_BATCH *)b)->size;
+
+	return (x > y ? -1 : (x < y ? 1 :
+		strcmp(((DF_BATCH *)a)->name, ((DF_BATCH *)b)->name)));
+}
+
+/*+
+	dff_BatchConvert()
+
+	Parameters
+		`d' is the info struct of a -b file.
+
+	Description
+		convert the file.  its dff_CleanUp() returns here,
+		instead of exiting.
+
+	Calls
+		System
+			setjmp().
+		Local
+			dff_Convert().
+
+	Return Values
+		Explicit
+			returns DF_SUCCESS or DF_FAILURE.
+
+	History
+		ag	16 oct 26
+ +*/
+int	dff_BatchConvert(d)
+DF_INFO	*d;
+{
+	jmp_buf	bail;
+	int	status;
+
+	d->bail = &bail;
+	if ((status = setjmp(bail)) == 0)
+		dff_Convert(d);
+	return status - 1;
+}
+
+/*+
+	dff_CompareName()
+
+	Description
+		qsort() comparison of two -b or -M files, by name.
+
+	History
+		ag	16 oct 26
+ +*/
+int	dff_CompareName(a, b)
+const void	*a,
+		*b;
+{
+	return strcmp(((DF_BATCH *)a)->name, ((DF_BATCH *)b)->name);
 }
 
 /*+
-	Dfile_WriteHeaderField()
+	dff_BatchFile()
 
 	Parameters
-		`d' is the info struct.
-		`fld_name' is the field name.
-		`indx' is the field index.
+		`d' is the info struct of the -b command line.
+		`b' is the dBase file to convert.
 
 	Description
-		the -g option was chosen; a Dfile .dfh file is
-		being generated.  add the Dfile-specific information
-		for `fld_name' to the .dfh file.
+		convert one -b file with its own copy of `d', so
+		conversions running at once share nothing.  the
+		model is named for the file, less its directory.
 
 	Calls
 		System
-			strcpy(), fprintf().
+			malloc(), free(), strrchr().
 		Local
-			CheckDiskSpace().
+			dff_BatchConvert().
+
+	Alters
+		Incoming
+			`b'.
 
 	History
-		dw	15 dec 92
+		ag	16 oct 26
  +*/
-void	Dfile_WriteHeaderField(d, fld_name, indx)
+void	dff_BatchFile(d, b)
 DF_INFO	*d;
-char	*fld_name;
-int	indx;
+DF_BATCH *b;
 {
-	/*
-		write the header info.
-	 */
-	fprintf(d->dfh, "{%s}\t{%s}\t{%s}\t{%d}\n",
-		fld_name,	/* the name of the field */
-		fld_name,	/* the help file look-up value for the field */
-		(d->fld_type[indx] == DBASE_NUMERIC_FLD ?	/* Dfile type */
-			(d->fld_dec[indx] == 0 ? "INT" : "FLT") :
-			(d->fld_type[indx] == DBASE_MEMO_FLD ? "MEMO" : "ALP")),
-		/*
-			the Dfile program needs the memo field to
-			contain the ASCII representation of the field
-			separator so that it can decode line breaks.
-		 */
-		(d->fld_type[indx] == DBASE_MEMO_FLD ?		/* field len */
-			DF_DELIM :
-		/*
-			all other field contains their field width
-		 */
-		d->fld_len[indx]));
+	DF_INFO	*f;
 
-	CheckDiskSpace(d, d->dfh);
+	if ((f = (DF_INFO *)malloc(sizeof(DF_INFO))) == (DF_INFO *)NULL)
+		return;
+	*f = *d;
+	f->in_file = f->out_file = f->model = b->name;
+	if (strrchr(b->name, '/') != (char *)NULL)
+		f->model = strrchr(b->name, '/') + 1;
+	f->batch = (DF_BATCH *)NULL;
+	f->num_batch = f->max_batch = 0;
+	f->num_jobs = 1;
+	f->flags.terse = (unsigned)1;
+	b->status = dff_BatchConvert(f);
+	b->records = f->num_records;
+	b->converted = f->converted;
+	free((char *)f);
 }
 
 /*+
-	Dfile_WriteHeaderBottom()
+	dff_BatchTake()
 
 	Parameters
-		`d' is the info struct.
+		`w' is a -b worker.
 
 	Description
-		the -g option was chosen; a Dfile .dfh file is
-		being generated.  finish-up Dfile-specific information
-		for the .dfh file, and then close it.
+		take the next file for a worker: the largest left of
+		its own, or else the smallest left of another's.
+		taking from the other end keeps a worker and the one
+		stealing from it apart.
 
 	Calls
 		System
-			fclose(), fprintf().
-		Local
-			CheckDiskSpace().
+			pthread_mutex_lock(), pthread_mutex_unlock().
 
 	Alters
 		Incoming
-			`d->dfh'.
+			`w->pool'.
+
+	Return Values
+		Explicit
+			returns the file #, or -1 when none are left.
 
 	History
-		dw	15 dec 92
+		ag	16 oct 26
  +*/
-void	Dfile_WriteHeaderBottom(d)
-DF_INFO	*d;
+int	dff_BatchTake(w)
+DF_WORKER *w;
 {
-	/*
-		close the Dfile header file.
-	 */
-	fclose(d->dfh);
+	DF_WORKER	*all = w->pool;
+	int		i,
+			item = -1;
 
-	if ((d->dfw = fopen(dff_FileAndExt(d->model,
-		DF_WIN_EXT), "w")) == (FILE *)NULL)
-		dff_OutOfSpace(d);
-	/*
-		write the Dfile window file.
-	 */
-	Dfile_WriteComment(d->dfh, "Dfile Version");
-	fprintf(d->dfh, "char\tVersion\t{%s}\n", DF_VERSION_STRING);
-	Dfile_WriteComment(d->dfh, "Dfile Model name");
-	fprintf(d->dfh, "char\tModel\t{%s}\n", d->model);
-	fprintf(d->dfw, "int\tUserListMax\t%d\n", d->num_flds);
-	fprintf(d->dfw, "int\tNumWindows\t1\n");
-	fprintf(d->dfw, "int\tTopWindow\t1\n");
-	fprintf(d->dfw, "char\tWindowFile[NumWindows]\n{%s}\n",
-		d->out_file);
-	fprintf(d->dfw, "char\tWindowGeometry[NumWindows][4]\n");
-	fprintf(d->dfw, "{%d}\t{%d}\t{%d}\t{%d}\n",
-		DF_WIN_GEOM_SX, DF_WIN_GEOM_SY,
-		DF_WIN_GEOM_EX, DF_WIN_GEOM_EY);
-	fprintf(d->dfw, "char\tTextGeometry[NumWindows][4]\n");
-	fprintf(d->dfw, "{%d}\t{%d}\t{%d}\t{%d}\n",
-		DF_TEXT_GEOM_SX, DF_TEXT_GEOM_SY,
-		DF_TEXT_GEOM_EX, DF_TEXT_GEOM_EY);
-	fprintf(d->dfw, "char\tUserListSize[NumWindows]\n{%d}\n",
-		d->num_flds);
-	fprintf(d->dfw, "char\tUserList[NumWindows][UserListMax]\n");
-	{
-		/*
-			write field ordering and search constraints.
-		 */
-		int	i;
-		for (i = 0 ; i < d->num_flds ; i++) {
-			fprintf(d->dfw,
-				"{%d%c%d%c%s%c%c%c%s}\n",
-				i + 1, DF_DELIM, i + 1, DF_DELIM,
-				DF_SEARCH_ALL, DF_DELIM, DF_DELIM,
-				DF_DELIM, DF_SEARCH_INCLUSIVE);
-		}
+	for (i = 0 ; i < w->num_workers && item < 0 ; i++) {
+		DF_WORKER	*v = &all[(w->id + i) % w->num_workers];
+
+#ifdef	DF_HAVE_THREADS
+		pthread_mutex_lock(&v->lock);
+#endif
+		if (v->head < v->tail)
+			item = (v == w ? v->item[v->head++] :
+				v->item[--(v->tail)]);
+#ifdef	DF_HAVE_THREADS
+		pthread_mutex_unlock(&v->lock);
+#endif
 	}
-	CheckDiskSpace(d, d->dfw);
-	fclose(d->dfw);
+	return item;
 }
 
 /*+
-	dBase_Init()
+	dff_BatchWorker()
 
 	Parameters
-		`d' is the info struct.
+		`arg' is a -b worker.
 
 	Description
-		attempt to open dBase files, check their integrity,
-		and set-up Dfile field info.
+		convert files until none are left.
 
 	Calls
-		System
-			open(), fseek(), fprintf(), malloc(), printf(),
-			fread(), fopen(), fclose().
 		Local
-			dff_FileAndExt(), dff_CleanUp() dff_BytesToLong(),
-			Dfile_WriteHeaderTop(), Dfile_WriteHeaderField(),
-			Dfile_WriteHeaderBottom(), Dfile_WriteHelpText(),
-			dff_StripString(), dff_OutOfSpace().
+			dff_BatchTake(), dff_BatchFile().
 
-	Alters
-		Incoming
-			`d'.
+	Return Values
+		Explicit
+			returns NULL.
 
 	History
-		dw	15 dec 92
+		ag	16 oct 26
  +*/
-void	dBase_Init(d)
-DF_INFO	*d;
+void	*dff_BatchWorker(arg)
+void	*arg;
 {
-	unsigned char	cookie;
+	DF_WORKER	*w = (DF_WORKER *)arg;
+	int		item;
 
-	if ((d->dbf = fopen(dff_FileAndExt(d->in_file, DBASE_DBF_EXT),
-		"rb")) == (FILE *)NULL) {
-		fprintf(stderr, "%s: cannot open dBase memo file `%s.dbt'\n",
-			PROGNAME, d->in_file);
-		dff_CleanUp(d, DF_FAILURE);
-	}
+	while ((item = dff_BatchTake(w)) >= 0)
+		dff_BatchFile(w->d, &w->d->batch[item]);
+	return (void *)NULL;
+}
 
-	/*
-		read the dBase header
-	 */
-	fseek(d->dbf, 0L, 0);
-	
-	if ((cookie = GetByte(d->dbf)) == DBASE_MEMO_COOKIE) {
-		if (FLAG_NOT_SET(d->flags.terse)) printf("has MEMOs\n");
-		if ((d->dbt = fopen(dff_FileAndExt(d->in_file,
-			DBASE_DBT_EXT), "rb")) == (FILE *)NULL) {
-			fprintf(stderr, "%s: cannot open memo file `%s.dbf'\n",
-				PROGNAME, d->in_file);
-			dff_CleanUp(d, DF_FAILURE);
-		}
-	} else if (cookie != DBASE_COOKIE) {
-		fprintf(stderr, "%s: `%s.dbt' not dBase format.\n",
-			PROGNAME, d->in_file);
-		dff_CleanUp(d, DF_FAILURE);
-	}
+/*+
+	dff_Batch()
 
-	/*
-		skip past the date bytes
-	 */
-	GetByte(d->dbf); GetByte(d->dbf); GetByte(d->dbf);
-	/*
-		set up number of things and allocate buffers
-	 */
-	d->num_records = GetLong(d->dbf);
-	d->fld_type = (int *)malloc(sizeof(int) * (d->num_flds =
-		((GetInt(d->dbf) - DBASE_HEADER_SIZE) / DBASE_HEADER_SIZE)));
-	d->fld_dec = (int *)malloc(sizeof(int) * d->num_flds);
-	d->fld_len = (int *)malloc(sizeof(int) * d->num_flds);
-	d->rec_buffer = (char *)malloc(sizeof(char) * ((d->bytes =
-		GetInt(d->dbf)) + 1));
-	d->out_buffer = (char *)
-		malloc(sizeof(char) * (d->bytes + d->num_flds + 1));
-	d->memo_buffer = (char *)malloc(sizeof(char) * (DF_MAX_MEMO_SIZE + 1));
+	Parameters
+		`d' is the info struct, with its -b files listed.
 
-	/*
-		skip 20 reserved bytes
-	 */
-	GetLong(d->dbf); GetLong(d->dbf); GetLong(d->dbf);
-	GetLong(d->dbf); GetLong(d->dbf);
+	Description
+		convert the -b files, `d->num_jobs' at a time, largest
+		first, and report on them all.  each worker is dealt
+		every n-th file of the list, and takes from the others
+		when its own run out.  exits DF_FAILURE if any file
+		failed.
 
-	if (FLAG_NOT_SET(d->flags.terse)) {
-		/*
-			reporting..
-		 */
-		printf("%d fields per record\n", d->num_flds);
-		printf("%ld records to process\n", d->num_records);
-	}
+	Calls
+		System
+			qsort(), strcmp(), calloc(), free(), time(), printf(),
+			fflush(), exit(), pthread_mutex_init(),
+			pthread_mutex_destroy(), pthread_create(),
+			pthread_join().
+		Local
+			dff_BatchSize(), dff_CompareBatch(), dff_BatchWorker(),
+			dff_OutOfSpace().
 
-	if (d->split != DF_NOT_SPLIT) {
+	History
+		ag	16 oct 26
+ +*/
+void	dff_Batch(d)
+DF_INFO	*d;
+{
+	DF_WORKER	*w;
+	int		n,
+			failed = 0,
+			i;
+	long		records = 0L,
+			converted = 0L;
+	time_t		start = time((time_t *)NULL);
+
+	for (i = 0 ; i < d->num_batch ; i++)
+		dff_BatchSize(d, &d->batch[i]);
+	qsort((char *)d->batch, d->num_batch, sizeof(DF_BATCH),
+		dff_CompareBatch);
+	for (i = n = 1 ; i < d->num_batch ; i++)
 		/*
-			split fields are specified as 1..n, used as 0..n-1
+			a file named twice is converted once.
 		 */
-		d->split--;
-		if (d->split < 0 || d->split > d->num_flds) {
-			fprintf(stderr, "%s: split field range: %d..%d\n",
-				PROGNAME, 1, d->num_flds);
-			dff_CleanUp(d, DF_FAILURE);
-		}
+		if (strcmp(d->batch[i].name, d->batch[n - 1].name) != 0)
+			d->batch[n++] = d->batch[i];
+		else
+			free(d->batch[i].name);
+	if (d->num_batch > 0) d->num_batch = n;
+	n = d->num_jobs;
+	if (n > d->num_batch) n = d->num_batch;
+	if (FLAG_NOT_SET(d->flags.terse)) {
+		printf("%s: converting %d files, %d at a time\n",
+			PROGNAME, d->num_batch, n);
+		fflush(stdout);
 	}
 
-	if (FLAG_SET(d->flags.headers))
-		/*
-			if the header file is used, initialise it.
-		 */
-		Dfile_WriteHeaderTop(d);
-
-	{
-		/*
-			get field info from dBase file.
-		 */
-		int	i, max_len = 0;
-
-		if (FLAG_SET(d->flags.help))
-			/*
-				writing the help file template
-			 */
-			if ((d->hlp = fopen(dff_FileAndExt(d->model,
-				DF_HLP_EXT), "w")) == (FILE *)NULL)
-				dff_OutOfSpace(d);
-
-		for (i = 0 ; i < d->num_flds ; i++) {
-			char	name[DBASE_FLD_NAME_LEN + 1],
-				*stripped_name = (char *)&name[0];
-
-			if (fread((char *)name, 1, DBASE_FLD_NAME_LEN,
-				d->dbf) != DBASE_FLD_NAME_LEN) {
-				fprintf(stderr,
-					"%s: problems reading field %d!\n",
-					PROGNAME, i + 1);
-				dff_CleanUp(d, DF_FAILURE);
-			}
-			dff_StripString(&stripped_name, DBASE_FLD_NAME_LEN);
-
-			d->fld_type[i] = GetByte(d->dbf); GetLong(d->dbf);
-			d->fld_len[i] = GetByte(d->dbf);
-			d->fld_dec[i] = GetByte(d->dbf);
-			/*
-				skip 14 reserved bytes
-			 */
-			GetLong(d->dbf); GetLong(d->dbf);
-			GetLong(d->dbf); GetInt(d->dbf);
-
-			if (FLAG_SET(d->flags.help))
-				/*
-					write the help template for this field
-				 */
-				Dfile_WriteHelpText(d, stripped_name);
-
-			if (d->fld_len[i] > max_len)
-				max_len = d->fld_len[i];
-
-			if (i == d->split && d->split != DF_NOT_SPLIT) {
-				if (d->fld_type[i] != DBASE_CHARACTER_FLD) {
-					fprintf(stderr,
-					"%s: split field (%s) not CHAR type\n",
-						PROGNAME, stripped_name);
-					dff_CleanUp(d, DF_FAILURE);
-				} else if (FLAG_NOT_SET(d->flags.terse))
-					printf("splitting on (%s)\n",
-						stripped_name);
-			}
-			if (FLAG_SET(d->flags.headers))
-				/*
-					write the header info for this field
-				 */
-				Dfile_WriteHeaderField(d, stripped_name, i);
-		}
-		d->fld_buffer = (char *)malloc(sizeof(char) * (max_len + 2));
-		if (FLAG_SET(d->flags.help))
-			fclose(d->hlp);
+	if ((w = (DF_WORKER *)calloc((size_t)n, sizeof(DF_WORKER))) ==
+		(DF_WORKER *)NULL)
+		dff_OutOfSpace(d);
+	for (i = 0 ; i < n ; i++) {
+		w[i].d = d;
+		w[i].pool = w;
+		w[i].id = i;
+		w[i].num_workers = n;
+		if ((w[i].item = (int *)malloc(sizeof(int) *
+			(d->num_batch / n + 1))) == (int *)NULL)
+			dff_OutOfSpace(d);
+#ifdef	DF_HAVE_THREADS
+		pthread_mutex_init(&w[i].lock, (pthread_mutexattr_t *)NULL);
+#endif
 	}
+	for (i = 0 ; i < d->num_batch ; i++)
+		w[i % n].item[w[i % n].tail++] = i;
+
+#ifdef	DF_HAVE_THREADS
+	for (i = 1 ; i < n ; i++)
+		w[i].started = (pthread_create(&w[i].thread,
+			(pthread_attr_t *)NULL, dff_BatchWorker,
+			(void *)&w[i]) == 0);
+#endif
+	(void)dff_BatchWorker((void *)&w[0]);
+#ifdef	DF_HAVE_THREADS
+	for (i = 1 ; i < n ; i++)
+		if (w[i].started)
+			pthread_join(w[i].thread, (void **)NULL);
+	for (i = 0 ; i < n ; i++)
+		pthread_mutex_destroy(&w[i].lock);
+#endif
 
 	/*
-		read the dBase end-of-header byte
+		the report.
 	 */
-	GetByte(d->dbf);
-
-	if (FLAG_SET(d->flags.headers))
-		/*
-			finish up the .dfh and start the .dfw file.
-		 */
-		Dfile_WriteHeaderBottom(d);
+	printf("%12s %12s %12s  %-6s %s\n", "records", "converted",
+		"bytes", "status", "file");
+	for (i = 0 ; i < d->num_batch ; i++) {
+		DF_BATCH	*b = &d->batch[i];
+
+		printf("%12ld %12ld %12ld  %-6s %s\n", b->records,
+			b->converted, b->size,
+			(b->status == DF_SUCCESS ? "ok" : "FAILED"), b->name);
+		if (b->status != DF_SUCCESS) failed++;
+		records += b->records;
+		converted += b->converted;
+	}
+	printf("%s: %d files, %d failed; %ld dBase records -> %ld Dfile records in %ld seconds\n",
+		PROGNAME, d->num_batch, failed, records, converted,
+		(long)(time((time_t *)NULL) - start));
+
+	for (i = 0 ; i < n ; i++)
+		free((char *)w[i].item);
+	free((char *)w);
+	for (i = 0 ; i < d->num_batch ; i++)
+		free(d->batch[i].name);
+	free((char *)d->batch);
+	exit(failed > 0 ? DF_FAILURE : DF_SUCCESS);
 }
 
 /*+
@@ -1654,15 +10008,13 @@ DF_INFO	*d;
 
 	Description
 		body of dbf2dff; set things up, process the command-line
-		arguments, open the dBase files, process the dBase records,
-		and clean-up.
+		arguments, and convert the dBase file, or with -b, the
+		dBase files, or with -M, the dBase files into one.
 
 	Calls
-		System
-			printf().
 		Local
-			dff_Init(), dff_DecodeArgs(), dBase_Init(),
-			dBase_ProcessRecord(), Cleanup().
+			dff_Init(), dff_DecodeArgs(), dff_MaxOpen(),
+			dff_Convert(), dff_Batch(), dff_Merge().
 
 	History
 		dw	15 dec 92
@@ -1678,17 +10030,11 @@ char	*argv[];
 	 */
 	dff_Init(&d);
 	dff_DecodeArgs(&d, argc, argv);
-	dBase_Init(&d);
-	d.report = (int)(d.num_records / 100) + 1;
-	/*
-		process the records.
-	 */
-	for (d.rec_num = 0 ; d.rec_num < d.num_records ; d.rec_num++)
-		dBase_ProcessRecord(&d);
-	if (FLAG_NOT_SET(d.flags.terse))
-		printf("100%% converted\n");
-	/*
-		and exit.
-	 */
-	dff_CleanUp(&d, DF_SUCCESS);
+	dff_MaxOpen(&d);
+	if (FLAG_SET(d.flags.batch))
+		dff_Batch(&d);
+	else if (FLAG_SET(d.flags.merge))
+		dff_Merge(&d);
+	else
+		dff_Convert(&d);
 }